@@ -0,0 +1,333 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nvutility.h"
+
+#include "pfm.h"
+
+#include "band_cache.h"
+
+
+/*  The cache file is a header followed by one entry per band (signature, the BEAM_STATS totals, the
+    number of beam records, and the records themselves).  It is written in native byte order; the header
+    check rejects a cache written by a different build.  */
+
+typedef struct
+{
+    char                    magic[12];
+    int32_t                 version;
+    int32_t                 width;
+    int32_t                 height;
+    int32_t                 band_rows;
+    int32_t                 record_size;
+    int32_t                 num_bands;
+    float                   null_depth;
+} CACHE_HEADER;
+
+
+#define       BAND_TOTALS          (9 + COVERAGE_LEVELS)
+
+
+static void set_header (CACHE_HEADER *header, BAND_CACHE *cache, int32_t width, int32_t height, float null_depth)
+{
+    memset (header, 0, sizeof (CACHE_HEADER));
+    strcpy (header->magic, BAND_CACHE_MAGIC);
+    header->version = BAND_CACHE_VERSION;
+    header->width = width;
+    header->height = height;
+    header->band_rows = BAND_ROWS;
+    header->record_size = sizeof (BEAM_RECORD);
+    header->num_bands = cache->num_bands;
+    header->null_depth = null_depth;
+}
+
+
+
+static void get_totals (BEAM_STATS *stats, int64_t *totals)
+{
+    totals[0] = stats->total_filter;
+    totals[1] = stats->total_manual;
+    totals[2] = stats->total_pfm;
+    totals[3] = stats->total_bad;
+    totals[4] = stats->total_good;
+    totals[5] = stats->total_select;
+    totals[6] = stats->bin_count;
+    totals[7] = stats->bin2_count;
+    totals[8] = stats->bad_beams;
+    memcpy (&totals[9], stats->coverage, COVERAGE_LEVELS * sizeof (int64_t));
+}
+
+
+
+static void set_totals (BEAM_STATS *stats, int64_t *totals)
+{
+    stats->total_filter = totals[0];
+    stats->total_manual = totals[1];
+    stats->total_pfm = totals[2];
+    stats->total_bad = totals[3];
+    stats->total_good = totals[4];
+    stats->total_select = totals[5];
+    stats->bin_count = totals[6];
+    stats->bin2_count = totals[7];
+    stats->bad_beams = totals[8];
+    memcpy (stats->coverage, &totals[9], COVERAGE_LEVELS * sizeof (int64_t));
+}
+
+
+
+void band_cache_init (BAND_CACHE *cache, int32_t height)
+{
+    cache->num_bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+    cache->reused = 0;
+
+    if ((cache->signature = (uint64_t *) calloc (cache->num_bands + 1, sizeof (uint64_t))) == NULL ||
+        (cache->stats = (BEAM_STATS **) calloc (cache->num_bands + 1, sizeof (BEAM_STATS *))) == NULL)
+    {
+        perror ("Allocating band cache");
+        exit (-1);
+    }
+}
+
+
+
+void band_cache_free (BAND_CACHE *cache)
+{
+    int32_t                 i;
+
+
+    for (i = 0 ; i < cache->num_bands ; i++)
+    {
+        if (cache->stats[i]) free_beam_stats (cache->stats[i]);
+    }
+
+    free (cache->stats);
+    free (cache->signature);
+    cache->num_bands = 0;
+}
+
+
+
+/*  FNV-1a over the bin record fields that change when any of the bin's soundings is edited.  */
+
+static uint64_t hash_bytes (uint64_t hash, void *data, int32_t size)
+{
+    uint8_t                 *byte = (uint8_t *) data;
+    int32_t                 i;
+
+
+    for (i = 0 ; i < size ; i++)
+    {
+        hash ^= byte[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return (hash);
+}
+
+
+
+/*  Checksum every band's bin records.  This only reads the bin file (a row at a time) so it costs a
+    small fraction of a full pass.  Returns 0, or -1 if a row couldn't be read.  */
+
+int32_t band_cache_sign (BAND_CACHE *cache, int32_t pfm_handle, int32_t width, int32_t height)
+{
+    BIN_RECORD              *bin;
+    uint64_t                hash = 0;
+    int32_t                 i, j;
+
+
+    if ((bin = (BIN_RECORD *) malloc (width * sizeof (BIN_RECORD))) == NULL)
+    {
+        perror ("Allocating bin row");
+        exit (-1);
+    }
+
+
+    for (i = 0 ; i < height ; i++)
+    {
+        if (!(i % BAND_ROWS)) hash = 0xcbf29ce484222325ULL;
+
+        if (read_bin_row (pfm_handle, width, i, 0, bin))
+        {
+            free (bin);
+            return (-1);
+        }
+
+        for (j = 0 ; j < width ; j++)
+        {
+            hash = hash_bytes (hash, &bin[j].num_soundings, sizeof (bin[j].num_soundings));
+            hash = hash_bytes (hash, &bin[j].validity, sizeof (bin[j].validity));
+            hash = hash_bytes (hash, &bin[j].standard_dev, sizeof (bin[j].standard_dev));
+            hash = hash_bytes (hash, &bin[j].avg_filtered_depth, sizeof (bin[j].avg_filtered_depth));
+            hash = hash_bytes (hash, &bin[j].min_filtered_depth, sizeof (bin[j].min_filtered_depth));
+            hash = hash_bytes (hash, &bin[j].max_filtered_depth, sizeof (bin[j].max_filtered_depth));
+            hash = hash_bytes (hash, &bin[j].avg_depth, sizeof (bin[j].avg_depth));
+            hash = hash_bytes (hash, &bin[j].min_depth, sizeof (bin[j].min_depth));
+            hash = hash_bytes (hash, &bin[j].max_depth, sizeof (bin[j].max_depth));
+        }
+
+        cache->signature[i / BAND_ROWS] = hash;
+    }
+
+    free (bin);
+
+    return (0);
+}
+
+
+
+/*  Read the cache file and keep the bands whose signature still matches (band_cache_sign has to have
+    been called first).  Returns the number of bands kept, or -1 if there is no usable cache.  */
+
+int32_t band_cache_load (BAND_CACHE *cache, char *path, int32_t width, int32_t height, float null_depth)
+{
+    FILE                    *fp;
+    CACHE_HEADER            header, expected;
+    BEAM_STATS              *stats;
+    uint64_t                signature;
+    int64_t                 totals[BAND_TOTALS];
+    int32_t                 i, size;
+
+
+    if ((fp = fopen (path, "rb")) == NULL) return (-1);
+
+    set_header (&expected, cache, width, height, null_depth);
+
+    if (fread (&header, sizeof (CACHE_HEADER), 1, fp) != 1 || memcmp (&header, &expected, sizeof (CACHE_HEADER)))
+    {
+        fclose (fp);
+        return (-1);
+    }
+
+
+    for (i = 0 ; i < cache->num_bands ; i++)
+    {
+        if (fread (&signature, sizeof (uint64_t), 1, fp) != 1 ||
+            fread (totals, sizeof (int64_t), BAND_TOTALS, fp) != BAND_TOTALS ||
+            fread (&size, sizeof (int32_t), 1, fp) != 1 || size < 0 || size > BEAM_TABLE_LIMIT) break;
+
+        if ((stats = (BEAM_STATS *) malloc (sizeof (BEAM_STATS))) == NULL)
+        {
+            perror ("Allocating band statistics");
+            exit (-1);
+        }
+
+        init_beam_stats (stats);
+        set_totals (stats, totals);
+
+        if (size) beam_table_grow (&stats->beams, size - 1);
+
+        if (fread (stats->beams.beam, sizeof (BEAM_RECORD), size, fp) != (size_t) size)
+        {
+            free_beam_stats (stats);
+            break;
+        }
+
+        if (signature == cache->signature[i])
+        {
+            cache->stats[i] = stats;
+            cache->reused++;
+        }
+        else
+        {
+            free_beam_stats (stats);
+        }
+    }
+
+    fclose (fp);
+
+
+    /*  A truncated file is no good at all.  */
+
+    if (i < cache->num_bands)
+    {
+        for (i = 0 ; i < cache->num_bands ; i++)
+        {
+            if (cache->stats[i]) free_beam_stats (cache->stats[i]);
+            cache->stats[i] = NULL;
+        }
+
+        cache->reused = 0;
+
+        return (-1);
+    }
+
+    return (cache->reused);
+}
+
+
+
+/*  Write every band's partials (all of them have to be filled in, and none flushed) to a temporary file
+    and rename it over "path" so a failed write never leaves a bad cache behind.  Returns 0 or -1.  */
+
+int32_t band_cache_save (BAND_CACHE *cache, char *path, int32_t width, int32_t height, float null_depth)
+{
+    FILE                    *fp;
+    CACHE_HEADER            header;
+    BEAM_STATS              *stats;
+    char                    tmp_path[1100];
+    int64_t                 totals[BAND_TOTALS];
+    int32_t                 i, status = 0;
+
+
+    if (snprintf (tmp_path, sizeof (tmp_path), "%s.tmp", path) >= (int) sizeof (tmp_path)) return (-1);
+
+    if ((fp = fopen (tmp_path, "wb")) == NULL) return (-1);
+
+    set_header (&header, cache, width, height, null_depth);
+
+    if (fwrite (&header, sizeof (CACHE_HEADER), 1, fp) != 1) status = -1;
+
+    for (i = 0 ; i < cache->num_bands && !status ; i++)
+    {
+        /*  A flushed band's counts are in beams.count, which the cache doesn't hold.  */
+
+        if ((stats = cache->stats[i]) == NULL || stats->flushed)
+        {
+            status = -1;
+            break;
+        }
+
+        get_totals (stats, totals);
+
+        if (fwrite (&cache->signature[i], sizeof (uint64_t), 1, fp) != 1 ||
+            fwrite (totals, sizeof (int64_t), BAND_TOTALS, fp) != BAND_TOTALS ||
+            fwrite (&stats->beams.size, sizeof (int32_t), 1, fp) != 1 ||
+            fwrite (stats->beams.beam, sizeof (BEAM_RECORD), stats->beams.size, fp) != (size_t) stats->beams.size)
+            status = -1;
+    }
+
+    if (fclose (fp)) status = -1;
+
+    if (status || rename (tmp_path, path))
+    {
+        remove (tmp_path);
+        return (-1);
+    }
+
+    return (0);
+}
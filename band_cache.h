@@ -0,0 +1,72 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __BAND_CACHE_H__
+#define __BAND_CACHE_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include "nvutility.h"
+
+#include "pfm.h"
+
+#include "engine.h"
+
+
+#define       BAND_CACHE_MAGIC     "PFMBSCACHE"
+#define       BAND_CACHE_VERSION   3
+
+
+  /*  Sidecar cache of the per band partial results.  Each band's entry is keyed by a 64 bit checksum of
+      its bin records (sounding count, validity, and the depth summaries), which change whenever a
+      sounding in the bin is edited.  On the next run only the bands whose checksum changed are read and
+      accumulated again, the rest are merged straight from the cache.  Since the partials are merged in
+      band order either way the report is identical to a full pass.
+
+      Sounding flag changes that leave the bin record untouched (selecting a sounding, for instance)
+      are not seen, so the cache should be rebuilt (or removed) after those.  */
+
+  typedef struct
+  {
+    int32_t       num_bands;
+    uint64_t      *signature;          /*  checksum of each band's bin records      */
+    BEAM_STATS    **stats;             /*  reusable (or freshly computed) partials  */
+    int32_t       reused;              /*  bands taken from the cache file          */
+  } BAND_CACHE;
+
+
+  void band_cache_init (BAND_CACHE *cache, int32_t height);
+  void band_cache_free (BAND_CACHE *cache);
+  int32_t band_cache_sign (BAND_CACHE *cache, int32_t pfm_handle, int32_t width, int32_t height);
+  int32_t band_cache_load (BAND_CACHE *cache, char *path, int32_t width, int32_t height, float null_depth);
+  int32_t band_cache_save (BAND_CACHE *cache, char *path, int32_t width, int32_t height, float null_depth);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,552 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "nvutility.h"
+
+#include "pfm.h"
+
+#include "batch.h"
+#include "report.h"
+#include "export.h"
+#include "state.h"
+
+
+/*  Batch mode.  Every file is split into the same BAND_ROWS row bands used for a single file and all of
+    the bands from all of the files go into one task list that the worker threads pull from.  The files
+    are ordered largest first so that by the time the pool is draining it is working on small bands of
+    small files and no thread is left holding one huge file at the end.  Within a file the band results
+    are merged in band order, so each file's report is identical to running it on its own.  */
+
+typedef struct
+{
+    char                    *path;
+    PFM_OPEN_ARGS           open_args;       /* header from the initial open                 */
+    NV_BOOL                 failed;          /* couldn't be opened (or reopened)             */
+    int32_t                 first_task;      /* task number of band 0                        */
+    int32_t                 num_bands;
+    int32_t                 next_merge;      /* next band to be merged into total            */
+    BEAM_STATS              **band_stats;    /* finished bands waiting to be merged          */
+    BEAM_STATS              *total;
+    BEAMSTATS_RESULT        *result;         /* set once every band has been merged          */
+    char                    report_path[1100];
+    NV_BOOL                 report_ok;
+    char                    state_path[1100];    /* written with options->save_state           */
+} BATCH_FILE;
+
+
+typedef struct
+{
+    BATCH_OPTIONS           *options;
+    int32_t                 num_files;
+    BATCH_FILE              *file;
+    int32_t                 num_tasks;
+    int32_t                 *task_file;      /* file each task (band) belongs to             */
+    int32_t                 next_task;       /* next task to be handed out                   */
+    int64_t                 total_rows;
+    int64_t                 rows_done;
+    int32_t                 old_percent;
+    pthread_mutex_t         mutex;
+    pthread_mutex_t         open_mutex;      /* the PFM library's open and close aren't reentrant */
+} BATCH;
+
+
+/*  One per worker.  "file" and "pfm_handle" belong to whichever thread does the reading (the reader
+    thread if there is read ahead).  Tasks are handed out in file order so a worker only ever needs one
+    handle open at a time.  */
+
+typedef struct
+{
+    BATCH                   *batch;
+    int32_t                 file;            /* file pfm_handle is open on (-1 for none)     */
+    int32_t                 pfm_handle;
+    ROW_READER              reader;
+    pthread_t               thread;
+} BATCH_WORKER;
+
+
+typedef struct
+{
+    int64_t                 bins;
+    int32_t                 index;
+} FILE_SIZE;
+
+
+
+static int32_t compare_size (const void *a, const void *b)
+{
+    FILE_SIZE *sa = (FILE_SIZE *) a, *sb = (FILE_SIZE *) b;
+
+
+    if (sa->bins != sb->bins) return (sa->bins > sb->bins ? -1 : 1);
+
+    return (sa->index - sb->index);
+}
+
+
+
+/*  NEXT_BAND callback.  Takes the next task and makes sure the worker has a handle on its file.  */
+
+static NV_BOOL next_task (void *data, int32_t *band, int32_t *start_row, int32_t *end_row)
+{
+    BATCH_WORKER            *worker = (BATCH_WORKER *) data;
+    BATCH                   *batch = worker->batch;
+    BATCH_FILE              *file;
+    PFM_OPEN_ARGS           open_args;
+    int32_t                 task, f;
+
+
+    pthread_mutex_lock (&batch->mutex);
+    task = batch->next_task++;
+    pthread_mutex_unlock (&batch->mutex);
+
+    if (task >= batch->num_tasks) return (NVFalse);
+
+    f = batch->task_file[task];
+    file = &batch->file[f];
+
+    if (f != worker->file)
+    {
+        memset (&open_args, 0, sizeof (PFM_OPEN_ARGS));
+        strcpy (open_args.list_path, file->path);
+        open_args.checkpoint = 0;
+
+        pthread_mutex_lock (&batch->open_mutex);
+        if (worker->pfm_handle >= 0) close_pfm_file (worker->pfm_handle);
+        worker->pfm_handle = open_existing_pfm_file (&open_args);
+        pthread_mutex_unlock (&batch->open_mutex);
+
+        if (worker->pfm_handle < 0)
+        {
+            pthread_mutex_lock (&batch->mutex);
+            file->failed = NVTrue;
+            pthread_mutex_unlock (&batch->mutex);
+        }
+
+        worker->file = f;
+    }
+
+    *band = task;
+    *start_row = (task - file->first_task) * BAND_ROWS;
+    *end_row = *start_row + BAND_ROWS;
+    if (*end_row > file->open_args.head.bin_height) *end_row = file->open_args.head.bin_height;
+
+    return (NVTrue);
+}
+
+
+
+/*  READ_ROW for the batch ("source" is the worker).  The row buffers are sized for the widest file.  */
+
+static int32_t read_task_row (void *source, int32_t row, ROW_BUFFER *buffer, PROFILE *profile)
+{
+    BATCH_WORKER            *worker = (BATCH_WORKER *) source;
+
+
+    buffer->width = worker->batch->file[worker->file].open_args.head.bin_width;
+
+    if (worker->pfm_handle < 0)
+    {
+        buffer->row = row;
+        buffer->soundings.count = 0;
+        buffer->read_errors = buffer->width;
+        memset (buffer->start, 0, (buffer->width + 1) * sizeof (int32_t));
+        return (-1);
+    }
+
+    return (read_pfm_row (&worker->pfm_handle, row, buffer, profile));
+}
+
+
+
+/*  Builds the file's result and writes its report (and state file).  Only called once per file, outside of
+    the lock.  */
+
+static void finish_file (BATCH *batch, BATCH_FILE *file)
+{
+    FILE                    *fp;
+
+
+    if ((file->result = beamstats_make_result (&file->open_args, file->total)) == NULL)
+    {
+        perror ("Allocating beam statistics result");
+        exit (-1);
+    }
+
+    file->total = NULL;
+
+    if (file->failed) return;
+
+    if ((fp = fopen (file->report_path, "w")) == NULL)
+    {
+        perror (file->report_path);
+        return;
+    }
+
+    file->report_ok = !beamstats_export (fp, file->result, batch->options->format);
+    file->report_ok = !fclose (fp) && file->report_ok;
+
+    if (batch->options->save_state && beamstats_save_state (file->state_path, file->result))
+        fprintf (stderr, "Unable to write state file %s\n", file->state_path);
+}
+
+
+
+/*  Finished with a task.  Merges the file's bands that are next in line and, if that was the file's last
+    band, writes its report.  */
+
+static void finish_task (BATCH *batch, int32_t task, int32_t rows, BEAM_STATS *stats)
+{
+    BATCH_FILE              *file = &batch->file[batch->task_file[task]];
+    NV_BOOL                 done;
+    int32_t                 merged, percent;
+
+
+    pthread_mutex_lock (&batch->mutex);
+
+    file->band_stats[task - file->first_task] = stats;
+
+    merged = file->next_merge;
+
+    while (file->next_merge < file->num_bands && file->band_stats[file->next_merge] != NULL)
+    {
+        merge_beam_stats (file->total, file->band_stats[file->next_merge]);
+        free_beam_stats (file->band_stats[file->next_merge]);
+        file->band_stats[file->next_merge] = NULL;
+        file->next_merge++;
+    }
+
+    done = (file->next_merge == file->num_bands && merged < file->num_bands);
+
+    batch->rows_done += rows;
+
+    percent = ((double) batch->rows_done / (double) batch->total_rows) * 100.0;
+    if (batch->options->progress && batch->old_percent != percent)
+    {
+        fprintf (stderr, "%03d%% processed     \r", percent);
+        batch->old_percent = percent;
+        fflush (stderr);
+    }
+
+    pthread_mutex_unlock (&batch->mutex);
+
+    if (done) finish_file (batch, file);
+}
+
+
+
+static void *batch_worker (void *arg)
+{
+    BATCH_WORKER            *worker = (BATCH_WORKER *) arg;
+    BATCH                   *batch = worker->batch;
+    BEAM_STATS              *stats = NULL;
+    ROW_BUFFER              *row;
+    int32_t                 rows = 0;
+
+
+    while ((row = row_reader_next (&worker->reader)) != NULL)
+    {
+        if (stats == NULL)
+        {
+            if ((stats = (BEAM_STATS *) malloc (sizeof (BEAM_STATS))) == NULL)
+            {
+                perror ("Allocating band statistics");
+                exit (-1);
+            }
+
+            init_beam_stats (stats);
+            rows = 0;
+        }
+
+        accumulate_row (row, batch->file[batch->task_file[row->band]].open_args.head.null_depth, stats);
+        rows++;
+
+        if (row->last)
+        {
+            finish_task (batch, row->band, rows, stats);
+            stats = NULL;
+        }
+
+        row_reader_release (&worker->reader, row);
+    }
+
+    return (NULL);
+}
+
+
+
+/*  Where a file's report (or state file) goes.  With a report directory it is the file's base name plus
+    "suffix" there, otherwise it sits next to the PFM.  Returns -1 if the name is too long.  */
+
+static int32_t output_path (BATCH_OPTIONS *options, char *path, char *suffix, char *output)
+{
+    char                    *name;
+
+
+    if (options->report_dir)
+    {
+        if ((name = strrchr (path, '/')) == NULL) name = path;
+        else name++;
+
+        return (snprintf (output, 1100, "%s/%s.%s", options->report_dir, name, suffix) >= 1100 ? -1 : 0);
+    }
+
+    return (snprintf (output, 1100, "%s.%s", path, suffix) >= 1100 ? -1 : 0);
+}
+
+
+
+static void write_summary (BATCH *batch, FILE *fp)
+{
+    BATCH_FILE              *file;
+    BEAMSTATS_RESULT        *result;
+    int64_t                 bins = 0, bins2 = 0, good = 0, bad = 0;
+    int32_t                 i, failed = 0;
+    double                  kilos = 0.0, s2_kilos = 0.0;
+
+
+    for (i = 0 ; i < batch->num_files ; i++) failed += batch->file[i].failed;
+
+    fprintf (fp, "#\n#Batch summary\n#\n");
+    fprintf (fp, "#Files:  %d  (%d failed)\n#\n", batch->num_files, failed);
+    fprintf (fp, "#   GOOD BINS      SQ KM   SQ KM 200%%      #GOOD       #BAD  %%EDITED    REPORT\n");
+    fprintf (fp, "#------------  ---------  ----------  ---------  ---------  -------    ------\n");
+
+    for (i = 0 ; i < batch->num_files ; i++)
+    {
+        file = &batch->file[i];
+
+        if (file->failed)
+        {
+            fprintf (fp, "#Unable to read %s\n", file->path);
+            continue;
+        }
+
+        result = file->result;
+
+        fprintf (fp, " %12lld  %9.3f  %10.3f  %9lld  %9lld  %7.2f    %s\n", (long long) result->stats.bin_count,
+                 result->square_kilometers, result->s2_kilos, (long long) result->stats.total_good,
+                 (long long) result->stats.total_bad,
+                 result->grand_total ? (double) result->stats.total_bad / (double) result->grand_total * 100.0 : 0.0,
+                 file->report_ok ? file->report_path : "(report not written)");
+
+        if (result->stats.read_errors)
+            fprintf (fp, "#  (%lld bins couldn't be read and were left out)\n", (long long) result->stats.read_errors);
+
+        bins += result->stats.bin_count;
+        bins2 += result->stats.bin2_count;
+        good += result->stats.total_good;
+        bad += result->stats.total_bad;
+        kilos += result->square_kilometers;
+        s2_kilos += result->s2_kilos;
+    }
+
+    fprintf (fp, "#------------------------------------------------------------------------------\n");
+    fprintf (fp, "#%12lld  %9.3f  %10.3f  %9lld  %9lld  %7.2f    All files\n", (long long) bins, kilos, s2_kilos,
+             (long long) good, (long long) bad,
+             good + bad ? (double) bad / (double) (good + bad) * 100.0 : 0.0);
+}
+
+
+
+/*  Process "paths" as one pool of tasks, write a report for each file, and write the summary to
+    "summary_fp".  Returns the number of files that couldn't be read (or had bins that couldn't be read).  */
+
+int32_t run_batch (int32_t num_files, char **paths, BATCH_OPTIONS *options, FILE *summary_fp)
+{
+    BATCH                   batch;
+    BATCH_FILE              *file;
+    BATCH_WORKER            *worker;
+    FILE_SIZE               *order;
+    int32_t                 i, j, k, handle, threads, max_width = 1, failed = 0;
+    char                    suffix[32];
+
+
+    memset (&batch, 0, sizeof (BATCH));
+    batch.options = options;
+    batch.num_files = num_files;
+    batch.old_percent = -1;
+    pthread_mutex_init (&batch.mutex, NULL);
+    pthread_mutex_init (&batch.open_mutex, NULL);
+
+    if ((batch.file = (BATCH_FILE *) calloc (num_files, sizeof (BATCH_FILE))) == NULL ||
+        (order = (FILE_SIZE *) calloc (num_files, sizeof (FILE_SIZE))) == NULL)
+    {
+        perror ("Allocating batch");
+        exit (-1);
+    }
+
+
+    /*  Read each header up front so the tasks can be laid out (and so unreadable files are skipped).  */
+
+    sprintf (suffix, "beamstats.%s", format_extension (options->format));
+
+    for (i = 0 ; i < num_files ; i++)
+    {
+        file = &batch.file[i];
+        file->path = paths[i];
+        file->open_args.checkpoint = 0;
+
+        if (snprintf (file->open_args.list_path, sizeof (file->open_args.list_path), "%s", paths[i]) >=
+            (int) sizeof (file->open_args.list_path) || output_path (options, file->path, suffix, file->report_path) ||
+            output_path (options, file->path, "bsstate", file->state_path))
+        {
+            fprintf (stderr, "%s : file name too long\n", paths[i]);
+            fflush (stderr);
+            file->failed = NVTrue;
+        }
+        else if ((handle = open_existing_pfm_file (&file->open_args)) < 0)
+        {
+            fprintf (stderr, "%s : %s\n", paths[i], pfm_error_str (pfm_error));
+            fflush (stderr);
+            file->failed = NVTrue;
+        }
+        else
+        {
+            close_pfm_file (handle);
+
+            file->num_bands = (file->open_args.head.bin_height + BAND_ROWS - 1) / BAND_ROWS;
+            if (file->open_args.head.bin_width > max_width) max_width = file->open_args.head.bin_width;
+
+            batch.num_tasks += file->num_bands;
+            batch.total_rows += file->open_args.head.bin_height;
+        }
+
+        order[i].bins = file->failed ? -1 : (int64_t) file->open_args.head.bin_width * file->open_args.head.bin_height;
+        order[i].index = i;
+    }
+
+    qsort (order, num_files, sizeof (FILE_SIZE), compare_size);
+
+    if ((batch.task_file = (int32_t *) malloc ((batch.num_tasks + 1) * sizeof (int32_t))) == NULL)
+    {
+        perror ("Allocating batch tasks");
+        exit (-1);
+    }
+
+    for (i = 0, k = 0 ; i < num_files ; i++)
+    {
+        file = &batch.file[order[i].index];
+
+        if (file->failed) continue;
+
+        file->first_task = k;
+
+        if ((file->band_stats = (BEAM_STATS **) calloc (file->num_bands + 1, sizeof (BEAM_STATS *))) == NULL ||
+            (file->total = (BEAM_STATS *) malloc (sizeof (BEAM_STATS))) == NULL)
+        {
+            perror ("Allocating batch file");
+            exit (-1);
+        }
+
+        init_beam_stats (file->total);
+
+        for (j = 0 ; j < file->num_bands ; j++) batch.task_file[k++] = order[i].index;
+    }
+
+    free (order);
+
+
+    threads = options->threads;
+    if (threads > batch.num_tasks) threads = batch.num_tasks;
+    if (threads < 1) threads = 1;
+
+    if ((worker = (BATCH_WORKER *) calloc (threads, sizeof (BATCH_WORKER))) == NULL)
+    {
+        perror ("Allocating workers");
+        exit (-1);
+    }
+
+    for (i = 0 ; i < threads ; i++)
+    {
+        worker[i].batch = &batch;
+        worker[i].file = -1;
+        worker[i].pfm_handle = -1;
+        if (row_reader_init (&worker[i].reader, read_task_row, &worker[i], max_width, NULL, options->queue_depth,
+                             (int64_t) options->queue_mb * 1024 * 1024, next_task, &worker[i], NULL))
+        {
+            perror ("Starting reader thread");
+            exit (-1);
+        }
+    }
+
+    for (i = 1 ; i < threads ; i++)
+    {
+        if (pthread_create (&worker[i].thread, NULL, batch_worker, &worker[i]))
+        {
+            perror ("Starting worker thread");
+            exit (-1);
+        }
+    }
+
+    batch_worker (&worker[0]);
+
+    for (i = 1 ; i < threads ; i++) pthread_join (worker[i].thread, NULL);
+
+    for (i = 0 ; i < threads ; i++)
+    {
+        row_reader_free (&worker[i].reader);
+        if (worker[i].pfm_handle >= 0) close_pfm_file (worker[i].pfm_handle);
+    }
+
+    free (worker);
+
+
+    /*  Files with no rows never had a task finish.  */
+
+    for (i = 0 ; i < num_files ; i++)
+    {
+        if (batch.file[i].total != NULL && batch.file[i].result == NULL) finish_file (&batch, &batch.file[i]);
+    }
+
+    if (options->progress)
+    {
+        fprintf (stderr, "%03d%% processed        \n\n", 100);
+        fflush (stderr);
+    }
+
+
+    write_summary (&batch, summary_fp);
+
+
+    for (i = 0 ; i < num_files ; i++)
+    {
+        file = &batch.file[i];
+
+        failed += (file->failed || (file->result && file->result->stats.read_errors));
+
+        if (file->result) beamstats_free_result (file->result);
+        if (file->band_stats) free (file->band_stats);
+    }
+
+    pthread_mutex_destroy (&batch.mutex);
+    pthread_mutex_destroy (&batch.open_mutex);
+    free (batch.task_file);
+    free (batch.file);
+
+    return (failed);
+}
@@ -0,0 +1,58 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdio.h>
+
+#include "nvutility.h"
+
+#include "beamstats.h"
+
+
+  typedef struct
+  {
+    int32_t       threads;             /*  worker threads for all of the files      */
+    int32_t       queue_depth;         /*  rows of read ahead per worker            */
+    int32_t       queue_mb;            /*  read ahead memory limit per worker (MB)  */
+    NV_BOOL       progress;            /*  print percent processed on stderr        */
+    char          *report_dir;         /*  per file report directory or NULL        */
+    int32_t       format;              /*  report format (FORMAT_TEXT, ... export.h) */
+    NV_BOOL       save_state;          /*  also write each file's state (state.h)   */
+  } BATCH_OPTIONS;
+
+
+  int32_t run_batch (int32_t num_files, char **paths, BATCH_OPTIONS *options, FILE *summary_fp);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
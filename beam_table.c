@@ -0,0 +1,180 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "beam_table.h"
+
+
+#define       BEAM_RECORD_ALIGN    128
+
+
+void beam_table_init (BEAM_TABLE *table)
+{
+    table->size = 0;
+    table->capacity = 0;
+    table->beam = NULL;
+    table->block = NULL;
+    table->count = NULL;
+}
+
+
+
+void beam_table_free (BEAM_TABLE *table)
+{
+    if (table->block) free (table->block);
+    if (table->count) free (table->count);
+
+    beam_table_init (table);
+}
+
+
+
+/*  Make room for "beam".  Returns 0 on success or -1 if the beam number is out of range.  Running out of
+    memory is fatal.  */
+
+int32_t beam_table_grow (BEAM_TABLE *table, int32_t beam)
+{
+    int32_t         i, capacity;
+    void            *block;
+    BEAM_RECORD     *records;
+    BEAM_COUNTS     *count;
+
+
+    if (beam < 0 || beam >= BEAM_TABLE_LIMIT) return (-1);
+
+
+    if (beam >= table->capacity)
+    {
+        capacity = table->capacity ? table->capacity * 2 : 256;
+        while (capacity <= beam) capacity *= 2;
+        if (capacity > BEAM_TABLE_LIMIT) capacity = BEAM_TABLE_LIMIT;
+
+
+        /*  Over allocate so we can align the records on a cache line pair.  */
+
+        if ((block = malloc (capacity * sizeof (BEAM_RECORD) + BEAM_RECORD_ALIGN)) == NULL ||
+            (count = (BEAM_COUNTS *) calloc (capacity, sizeof (BEAM_COUNTS))) == NULL)
+        {
+            perror ("Allocating beam table");
+            exit (-1);
+        }
+
+        records = (BEAM_RECORD *) (((uintptr_t) block + BEAM_RECORD_ALIGN - 1) & ~((uintptr_t) BEAM_RECORD_ALIGN - 1));
+
+        if (table->capacity)
+        {
+            memcpy (records, table->beam, table->capacity * sizeof (BEAM_RECORD));
+            memcpy (count, table->count, table->capacity * sizeof (BEAM_COUNTS));
+        }
+
+        for (i = table->capacity ; i < capacity ; i++)
+        {
+            memset (&records[i], 0, sizeof (BEAM_RECORD));
+            resid_stats_init (&records[i].resid);
+        }
+
+        if (table->block) free (table->block);
+        if (table->count) free (table->count);
+
+        table->block = block;
+        table->count = count;
+        table->beam = records;
+        table->capacity = capacity;
+    }
+
+
+    if (beam >= table->size) table->size = beam + 1;
+
+    return (0);
+}
+
+
+
+/*  Add the beam records in "part" to "total".  The part's band counters (and its merged counts, if it is
+    itself a merged table) go into total's 64 bit counts.  */
+
+void beam_table_merge (BEAM_TABLE *total, BEAM_TABLE *part)
+{
+    int32_t         i;
+    BEAM_RECORD     *p;
+    BEAM_COUNTS     *t, *pc;
+
+
+    if (!part->size) return;
+
+    beam_table_grow (total, part->size - 1);
+
+    for (i = 0 ; i < part->size ; i++)
+    {
+        p = &part->beam[i];
+        pc = &part->count[i];
+
+        if (!p->total_depths && !pc->total_depths) continue;
+
+        t = &total->count[i];
+
+        t->total_depths += (int64_t) p->total_depths + pc->total_depths;
+        t->bad += (int64_t) p->bad + pc->bad;
+        t->good += (int64_t) p->good + pc->good;
+        t->manual += (int64_t) p->manual + pc->manual;
+        t->filter += (int64_t) p->filter + pc->filter;
+        t->select += (int64_t) p->select + pc->select;
+        t->pfm += (int64_t) p->pfm + pc->pfm;
+        t->tvu_pass += (int64_t) p->tvu_pass + pc->tvu_pass;
+
+        resid_stats_merge (&total->beam[i].resid, &p->resid);
+    }
+}
+
+
+
+/*  Move the 32 bit band counters into the table's own 64 bit counts and clear them (see
+    BEAM_COUNTER_LIMIT).  beam_table_merge picks both up, so the merged totals don't change.  */
+
+void beam_table_flush (BEAM_TABLE *table)
+{
+    int32_t         i;
+    BEAM_RECORD     *p;
+    BEAM_COUNTS     *c;
+
+
+    for (i = 0 ; i < table->size ; i++)
+    {
+        p = &table->beam[i];
+        c = &table->count[i];
+
+        c->total_depths += p->total_depths;
+        c->bad += p->bad;
+        c->good += p->good;
+        c->manual += p->manual;
+        c->filter += p->filter;
+        c->select += p->select;
+        c->pfm += p->pfm;
+        c->tvu_pass += p->tvu_pass;
+
+        p->total_depths = p->bad = p->good = p->manual = p->filter = p->select = p->pfm = p->tvu_pass = 0;
+    }
+}
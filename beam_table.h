@@ -0,0 +1,119 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __BEAM_TABLE_H__
+#define __BEAM_TABLE_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdint.h>
+
+#include "resid_stats.h"
+
+
+  /*  Beam numbers are 16 bit in the PFM depth record so this is the hard upper limit.  The table itself
+      only grows as large as the highest beam number actually seen.  */
+
+#define       BEAM_TABLE_LIMIT     65536
+
+
+  /*  Most soundings the 32 bit BEAM_RECORD counters are allowed to take between flushes.  */
+
+#define       BEAM_COUNTER_LIMIT   INT32_MAX
+
+
+  /*  Everything accumulated for one beam.  A sounding only updates its own beam's record so the
+      fields are kept together (array of structures) instead of in a dozen separate per beam arrays.
+      The record is padded to 128 bytes and the table is 128 byte aligned so each sounding touches a
+      single aligned pair of adjacent cache lines.  The counters are 32 bit to keep it that size; they
+      only hold one band's soundings and are added into the 64 bit BEAM_COUNTS when the band is merged.
+      A single band can still hold more than 2^31 soundings (16 rows of a very wide, dense grid), so the
+      engine checks each row against BEAM_COUNTER_LIMIT first and, if the row could wrap a counter, moves
+      the band's counters into its own BEAM_COUNTS with beam_table_flush.  */
+
+  typedef struct
+  {
+    RESID_STATS   resid;               /*  repeatability statistics (72 bytes)      */
+    int32_t       total_depths;        /*  total number of depths                   */
+    int32_t       bad;                 /*  number of edits                          */
+    int32_t       good;                /*  number of good data points               */
+    int32_t       manual;              /*  number of manual edits                   */
+    int32_t       filter;              /*  number of filter edits                   */
+    int32_t       select;              /*  number of selected soundings             */
+    int32_t       pfm;                 /*  number of PFM_MODIFIED soundings         */
+    int32_t       tvu_pass;            /*  residuals within the TVU limit           */
+    uint8_t       pad[24];
+  } BEAM_RECORD;
+
+
+  /*  A beam's counts in a merged table (beam_table_merge), which can run past 2^31 on a large file.  */
+
+  typedef struct
+  {
+    int64_t       total_depths;
+    int64_t       bad;
+    int64_t       good;
+    int64_t       manual;
+    int64_t       filter;
+    int64_t       select;
+    int64_t       pfm;
+    int64_t       tvu_pass;
+  } BEAM_COUNTS;
+
+
+  typedef struct
+  {
+    int32_t       size;                /*  number of beam records in use            */
+    int32_t       capacity;            /*  number of beam records allocated         */
+    BEAM_RECORD   *beam;               /*  aligned beam records                     */
+    void          *block;              /*  unaligned allocation backing "beam"      */
+    BEAM_COUNTS   *count;              /*  merged counts (zero until merged into)   */
+  } BEAM_TABLE;
+
+
+  void beam_table_init (BEAM_TABLE *table);
+  void beam_table_free (BEAM_TABLE *table);
+  int32_t beam_table_grow (BEAM_TABLE *table, int32_t beam);
+  void beam_table_merge (BEAM_TABLE *total, BEAM_TABLE *part);
+  void beam_table_flush (BEAM_TABLE *table);
+
+
+  /*  Returns the record for "beam", growing the table if needed, or NULL if the beam number is out of
+      range.  */
+
+  static inline BEAM_RECORD *beam_table_get (BEAM_TABLE *table, int32_t beam)
+  {
+    if ((uint32_t) beam >= (uint32_t) table->size && beam_table_grow (table, beam)) return (NULL);
+
+    return (&table->beam[beam]);
+  }
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,588 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include "nvutility.h"
+
+#include "pfm.h"
+
+#include "beamstats.h"
+#include "raster.h"
+
+
+void beamstats_default_options (BEAMSTATS_OPTIONS *options)
+{
+    options->threads = 1;
+    options->queue_depth = 0;
+    options->queue_mb = 256;
+    options->stream = NVFalse;
+    options->progress = NVFalse;
+    options->profiling = NVFalse;
+    options->cache_path = NULL;
+    options->region = NULL;
+    options->tile_size = 0;
+    options->line_stats = NVFalse;
+    options->counts_only = NVFalse;
+    options->quantiles = NVFalse;
+    options->tvu = NVFalse;
+    options->tvu_a = 0.0;
+    options->tvu_b = 0.0;
+    options->num_depth_edges = 0;
+    options->depth_edges = NULL;
+    options->raster_path = NULL;
+}
+
+
+
+static BEAMSTATS *beamstats_alloc (BEAMSTATS_OPTIONS *options)
+{
+    BEAMSTATS               *bs;
+
+
+    if ((bs = (BEAMSTATS *) calloc (1, sizeof (BEAMSTATS))) == NULL) return (NULL);
+
+    bs->options = *options;
+    if (bs->options.threads < 1) bs->options.threads = 1;
+    if (bs->options.threads > MAX_THREADS) bs->options.threads = MAX_THREADS;
+
+    return (bs);
+}
+
+
+
+/*  Opens "list_path" once for each worker thread so that reads don't have to be serialized.  Returns NULL
+    (with pfm_error set) if the file can't be opened, or NULL with errno set to ENOMEM if there isn't
+    enough memory or ENAMETOOLONG if "list_path" won't fit in a PFM_OPEN_ARGS.  */
+
+BEAMSTATS *beamstats_open (char *list_path, BEAMSTATS_OPTIONS *options)
+{
+    BEAMSTATS               *bs;
+    PFM_OPEN_ARGS           worker_args;
+    int64_t                 start_ns;
+    int32_t                 i;
+
+
+    if (strlen (list_path) >= sizeof (bs->open_args.list_path))
+    {
+        errno = ENAMETOOLONG;
+        return (NULL);
+    }
+
+    if ((bs = beamstats_alloc (options)) == NULL)
+    {
+        errno = ENOMEM;
+        return (NULL);
+    }
+
+    bs->owns_handles = NVTrue;
+
+    start_ns = profile_clock ();
+
+    strcpy (bs->open_args.list_path, list_path);
+    bs->open_args.checkpoint = 0;
+
+    if ((bs->pfm_handle[0] = open_existing_pfm_file (&bs->open_args)) < 0)
+    {
+        free (bs);
+        return (NULL);
+    }
+
+    for (bs->num_handles = 1 ; bs->num_handles < bs->options.threads ; bs->num_handles++)
+    {
+        memset (&worker_args, 0, sizeof (PFM_OPEN_ARGS));
+        strcpy (worker_args.list_path, list_path);
+        worker_args.checkpoint = 0;
+
+        if ((bs->pfm_handle[bs->num_handles] = open_existing_pfm_file (&worker_args)) < 0)
+        {
+            for (i = 0 ; i < bs->num_handles ; i++) close_pfm_file (bs->pfm_handle[i]);
+            free (bs);
+            return (NULL);
+        }
+    }
+
+    bs->profile.open_ns = profile_clock () - start_ns;
+
+    return (bs);
+}
+
+
+
+/*  Uses a PFM handle the caller already has open (for instance right after loading it).  A single handle
+    can't be shared between threads so this always runs one worker, and the handle is left open.  Returns
+    NULL if there isn't enough memory.  */
+
+BEAMSTATS *beamstats_attach (int32_t pfm_handle, PFM_OPEN_ARGS *open_args, BEAMSTATS_OPTIONS *options)
+{
+    BEAMSTATS               *bs;
+
+
+    if ((bs = beamstats_alloc (options)) == NULL) return (NULL);
+
+    bs->options.threads = 1;
+    bs->owns_handles = NVFalse;
+    bs->open_args = *open_args;
+    bs->pfm_handle[0] = pfm_handle;
+    bs->num_handles = 1;
+
+    return (bs);
+}
+
+
+
+/*  Engine options for bs's file and options (no cached partials and no band list).  */
+
+static void engine_options (BEAMSTATS *bs, ENGINE_OPTIONS *options)
+{
+    options->width = bs->open_args.head.bin_width;
+    options->height = bs->open_args.head.bin_height;
+    options->null_depth = bs->open_args.head.null_depth;
+    options->threads = bs->num_handles;
+    options->queue_depth = bs->options.queue_depth;
+    options->queue_bytes = (int64_t) bs->options.queue_mb * 1024 * 1024;
+    options->progress = bs->options.progress;
+    options->profiling = bs->options.profiling;
+    options->region = bs->options.region;
+    options->tile_size = bs->options.tile_size;
+    options->line_stats = bs->options.line_stats;
+    options->counts_only = bs->options.counts_only;
+    options->quantiles = bs->options.quantiles;
+    options->tvu = bs->options.tvu;
+    options->tvu_a = bs->options.tvu_a;
+    options->tvu_b = bs->options.tvu_b;
+    options->num_depth_edges = bs->options.num_depth_edges;
+    options->depth_edges = bs->options.depth_edges;
+    options->band_stats = NULL;
+    options->keep_bands = NVFalse;
+    options->bands = NULL;
+    options->bin_grid = NVFalse;
+    options->merge_band = NULL;
+    options->band_claimed = NULL;
+}
+
+
+
+/*  BAND_CLAIMED callback for --stream.  */
+
+static void stream_band_claimed (void *data, int32_t claimed, int32_t num_claims)
+{
+    file_stream_advance ((FILE_STREAM *) data, (double) claimed / (double) num_claims);
+}
+
+
+
+/*  Runs every bin through the engine.  With a cache_path only the bands whose bin records changed since
+    the cache was written are read, and the cache is rewritten afterwards.  With a raster_path the per bin
+    QC raster is written as the bands are merged.  Returns 0, or -1 if it has already been run or the engine
+    failed (a thread couldn't be started or there wasn't enough memory).  */
+
+int32_t beamstats_accumulate (BEAMSTATS *bs)
+{
+    ENGINE_OPTIONS          options;
+    BAND_CACHE              cache;
+    RASTER_WRITER           raster;
+    REGION                  region;
+    NV_BOOL                 caching = NVFalse, rastering = NVFalse;
+    void                    *sources[MAX_THREADS];
+    int64_t                 start_ns;
+    int32_t                 i;
+
+
+    if (bs->total != NULL || bs->failed) return (-1);
+
+
+    engine_options (bs, &options);
+
+
+    /*  The cached partials are for whole rows and have no tiles, line tables, sketches, TVU counts, depth
+        bands, or bin grids, and always have the repeatability statistics (the cache doesn't record
+        --counts-only, so a counts only run would leave partials that a full run can't use).  */
+
+    if (bs->options.cache_path && bs->options.region == NULL && !bs->options.tile_size && !bs->options.line_stats &&
+        !bs->options.quantiles && !bs->options.tvu && !bs->options.num_depth_edges && !bs->options.raster_path &&
+        !bs->options.counts_only)
+    {
+        start_ns = profile_clock ();
+
+        band_cache_init (&cache, bs->open_args.head.bin_height);
+
+        if (band_cache_sign (&cache, bs->pfm_handle[0], bs->open_args.head.bin_width, bs->open_args.head.bin_height))
+        {
+            band_cache_free (&cache);
+        }
+        else
+        {
+            band_cache_load (&cache, bs->options.cache_path, bs->open_args.head.bin_width,
+                             bs->open_args.head.bin_height, bs->open_args.head.null_depth);
+
+            bs->cached_bands = cache.reused;
+            options.band_stats = cache.stats;
+            options.keep_bands = NVTrue;
+            caching = NVTrue;
+        }
+
+        bs->profile.bin_read_ns += profile_clock () - start_ns;
+    }
+
+
+    if (bs->options.stream)
+    {
+        bs->stream.count = 2;
+        strcpy (bs->stream.path[0], bs->open_args.index_path);
+        strcpy (bs->stream.path[1], bs->open_args.bin_path);
+        bs->stream.paced[0] = 0;
+        bs->stream.paced[1] = 1;
+
+        if ((bs->streaming = !file_stream_start (&bs->stream)))
+        {
+            options.band_claimed = stream_band_claimed;
+            options.band_claimed_data = &bs->stream;
+        }
+    }
+
+
+    if (bs->options.raster_path)
+    {
+        if (options.region) region = *options.region;
+        else region_grid (&region, options.width, options.height);
+
+        if (!raster_open (&raster, bs->options.raster_path, &bs->open_args, &region))
+        {
+            options.bin_grid = NVTrue;
+            options.merge_band = raster_write_band;
+            options.merge_band_data = &raster;
+            rastering = NVTrue;
+        }
+    }
+
+
+    for (i = 0 ; i < bs->num_handles ; i++) sources[i] = &bs->pfm_handle[i];
+
+    bs->total = run_engine (&options, read_pfm_row, sources, bs->options.profiling ? &bs->profile : NULL);
+
+    if (bs->streaming) file_stream_stop (&bs->stream);
+
+    if (rastering) bs->raster_saved = !raster_close (&raster);
+
+
+    /*  A band that couldn't all be read would come back from the cache looking complete.  */
+
+    if (caching)
+    {
+        if (bs->total && !bs->total->read_errors)
+            bs->cache_saved = !band_cache_save (&cache, bs->options.cache_path, bs->open_args.head.bin_width,
+                                                bs->open_args.head.bin_height, bs->open_args.head.null_depth);
+        band_cache_free (&cache);
+    }
+
+    if (bs->total == NULL)
+    {
+        bs->failed = NVTrue;
+        return (-1);
+    }
+
+    return (0);
+}
+
+
+
+/*  Preview mode.  Reads the bands in sample_order order, stopping when each of the num_steps fractions
+    (in increasing order) of them have been read to hand "callback" an estimate from the bands read so
+    far.  Then the rest are read and every band is merged in band order, so the result from
+    beamstats_finalize is exactly the same as after beamstats_accumulate.  The band cache, --stream (which
+    reads the whole file), and the QC raster aren't used.  Returns 0, or -1 if it has already been run or the
+    engine failed.  */
+
+int32_t beamstats_sample (BEAMSTATS *bs, int32_t num_steps, double *fraction, SAMPLE_CALLBACK callback,
+                          void *data)
+{
+    ENGINE_OPTIONS          options;
+    REGION                  region;
+    SAMPLE_ESTIMATE         estimate;
+    BEAM_STATS              **band_stats, *partial;
+    void                    *sources[MAX_THREADS];
+    int32_t                 i, num_bands, done, next, *order;
+
+
+    if (bs->total != NULL || bs->failed) return (-1);
+
+
+    engine_options (bs, &options);
+
+    if (options.region) region = *options.region;
+    else region_grid (&region, options.width, options.height);
+
+    num_bands = (region.y1 - region.y0 + BAND_ROWS - 1) / BAND_ROWS;
+
+    band_stats = NULL;
+
+    if ((order = (int32_t *) malloc (num_bands * sizeof (int32_t))) == NULL ||
+        (band_stats = (BEAM_STATS **) calloc (num_bands, sizeof (BEAM_STATS *))) == NULL)
+    {
+        free (order);
+        bs->failed = NVTrue;
+        return (-1);
+    }
+
+    sample_order (num_bands, order);
+
+    for (i = 0 ; i < bs->num_handles ; i++) sources[i] = &bs->pfm_handle[i];
+
+    options.band_stats = band_stats;
+    options.keep_bands = NVTrue;
+    options.progress = NVFalse;
+
+
+    for (i = 0, done = 0 ; i < num_steps ; i++)
+    {
+        next = (int32_t) ceil (fraction[i] * num_bands);
+        if (next >= num_bands) break;
+        if (next <= done) continue;
+
+        options.bands = order + done;
+        options.num_listed = next - done;
+
+        if ((partial = run_engine (&options, read_pfm_row, sources, bs->options.profiling ? &bs->profile : NULL))
+            == NULL)
+        {
+            bs->failed = NVTrue;
+            break;
+        }
+
+        free_beam_stats (partial);
+
+        done = next;
+
+        sample_estimate (&estimate, band_stats, order, done, num_bands, bs->open_args.head.bin_size_xy);
+        callback (&estimate, data);
+        sample_free (&estimate);
+    }
+
+
+    /*  Read the rest.  The bands that have already been read are merged straight from band_stats.  Nothing
+        is kept from here on, so only the sampled bands' partials (up to the last step's fraction) are
+        ever held at once, and each of those is freed as it's merged.  */
+
+    if (!bs->failed)
+    {
+        options.bands = NULL;
+        options.keep_bands = NVFalse;
+        options.progress = bs->options.progress;
+
+        if ((bs->total = run_engine (&options, read_pfm_row, sources, bs->options.profiling ? &bs->profile : NULL))
+            == NULL) bs->failed = NVTrue;
+    }
+
+
+    /*  Only left over if something failed.  */
+
+    for (i = 0 ; i < num_bands ; i++)
+    {
+        if (band_stats[i]) free_beam_stats (band_stats[i]);
+    }
+
+    free (band_stats);
+    free (order);
+
+    return (bs->failed ? -1 : 0);
+}
+
+
+
+/*  Builds a result for "open_args"'s file from its merged statistics, working out the totals and the
+    coverage areas.  The result takes over (and frees) "total".  Returns NULL (having freed "total") if
+    there isn't enough memory.  */
+
+BEAMSTATS_RESULT *beamstats_make_result (PFM_OPEN_ARGS *open_args, BEAM_STATS *total)
+{
+    BEAMSTATS_RESULT        *result;
+    int32_t                 i;
+
+
+    if ((result = (BEAMSTATS_RESULT *) calloc (1, sizeof (BEAMSTATS_RESULT))) == NULL)
+    {
+        free_beam_stats (total);
+        return (NULL);
+    }
+
+    strcpy (result->list_path, open_args->list_path);
+    result->width = open_args->head.bin_width;
+    result->height = open_args->head.bin_height;
+    result->bin_size_xy = open_args->head.bin_size_xy;
+    result->mbr = open_args->head.mbr;
+    result->x_bin_size_degrees = open_args->head.x_bin_size_degrees;
+    result->y_bin_size_degrees = open_args->head.y_bin_size_degrees;
+    region_grid (&result->region, result->width, result->height);
+    result->num_bands = (result->height + BAND_ROWS - 1) / BAND_ROWS;
+    result->runs = 1;
+
+    result->stats = *total;
+    free (total);
+
+    result->grand_total = result->stats.total_bad + result->stats.total_good;
+    result->square_kilometers = (result->stats.bin_count * (result->bin_size_xy * result->bin_size_xy)) /
+        (1000.0 * 1000.0);
+    result->square_nmiles = result->square_kilometers / (1.852 * 1.852);
+    result->s2_kilos = (result->stats.bin2_count * (result->bin_size_xy * result->bin_size_xy)) /
+        (1000.0 * 1000.0);
+    result->s2_nmiles = result->s2_kilos / (1.852 * 1.852);
+
+    for (i = 0 ; i < COVERAGE_LEVELS ; i++)
+    {
+        result->coverage_kilos[i] = (result->stats.coverage[i] * (result->bin_size_xy * result->bin_size_xy)) /
+            (1000.0 * 1000.0);
+        result->coverage_nmiles[i] = result->coverage_kilos[i] / (1.852 * 1.852);
+    }
+
+    return (result);
+}
+
+
+
+/*  Look up the file name of each line in the line table (while the handle is still open).  Returns 0, or
+    -1 if there isn't enough memory (result->num_lines is then however many were filled in).  */
+
+static int32_t line_names (BEAMSTATS *bs, BEAMSTATS_RESULT *result)
+{
+    LINE_TABLE              *lines = &result->stats.lines;
+    char                    *name;
+    int32_t                 i, line, count = 0, *present;
+
+
+    if ((present = (int32_t *) calloc (65536, sizeof (int32_t))) == NULL) return (-1);
+
+    for (i = 0 ; i < lines->capacity ; i++)
+    {
+        if (lines->entry[i].used && !present[lines->entry[i].key >> 16])
+        {
+            present[lines->entry[i].key >> 16] = 1;
+            count++;
+        }
+    }
+
+    if ((result->line = (int32_t *) malloc ((count + 1) * sizeof (int32_t))) == NULL ||
+        (result->line_name = (char **) malloc ((count + 1) * sizeof (char *))) == NULL)
+    {
+        free (present);
+        return (-1);
+    }
+
+    for (line = 0 ; line < 65536 ; line++)
+    {
+        if (!present[line]) continue;
+
+        name = read_line_file (bs->pfm_handle[0], (int16_t) line);
+
+        if ((result->line_name[result->num_lines] = strdup (name ? name : "")) == NULL)
+        {
+            free (present);
+            return (-1);
+        }
+
+        result->line[result->num_lines++] = (int16_t) line;
+    }
+
+    free (present);
+
+    return (0);
+}
+
+
+
+/*  Closes the handles (unless they were attached), builds the result, and frees "bs".  The caller frees
+    the result with beamstats_free_result.  Returns NULL (still closing the handles and freeing "bs") if the
+    statistics couldn't be computed, because a thread couldn't be started or there wasn't enough memory.  */
+
+BEAMSTATS_RESULT *beamstats_finalize (BEAMSTATS *bs)
+{
+    BEAMSTATS_RESULT        *result = NULL;
+    int32_t                 i;
+
+
+    if (bs->total == NULL && !bs->failed) beamstats_accumulate (bs);
+
+    if (bs->total) result = beamstats_make_result (&bs->open_args, bs->total);
+
+    if (result && result->stats.lines.capacity && line_names (bs, result))
+    {
+        beamstats_free_result (result);
+        result = NULL;
+    }
+
+    if (bs->owns_handles)
+    {
+        for (i = 0 ; i < bs->num_handles ; i++) close_pfm_file (bs->pfm_handle[i]);
+    }
+
+    if (result == NULL)
+    {
+        free (bs);
+        return (NULL);
+    }
+
+    result->threads = bs->num_handles;
+    result->queue_depth = bs->options.queue_depth;
+    result->stream_bytes = bs->streaming ? bs->stream.bytes : 0;
+    result->stream_skipped = bs->streaming ? bs->stream.skipped : 0;
+    result->cached_bands = bs->cached_bands;
+    result->cache_saved = bs->cache_saved;
+    result->raster_saved = bs->raster_saved;
+    result->profile = bs->profile;
+
+    if (bs->options.region)
+    {
+        region_window (&result->region, result->width, result->height, bs->options.region->x0,
+                       bs->options.region->y0, bs->options.region->x1, bs->options.region->y1);
+        result->subset = NVTrue;
+    }
+
+    free (bs);
+
+    return (result);
+}
+
+
+
+void beamstats_free_result (BEAMSTATS_RESULT *result)
+{
+    int32_t                 i;
+
+
+    beam_table_free (&result->stats.beams);
+    tile_grid_free (&result->stats.tiles);
+    line_table_free (&result->stats.lines);
+    sketch_table_free (&result->stats.sketches);
+    depth_table_free (&result->stats.depths);
+
+    for (i = 0 ; i < result->num_lines ; i++) free (result->line_name[i]);
+
+    if (result->line) free (result->line);
+    if (result->line_name) free (result->line_name);
+
+    free (result);
+}
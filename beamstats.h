@@ -0,0 +1,164 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __BEAMSTATS_H__
+#define __BEAMSTATS_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include "nvutility.h"
+
+#include "pfm.h"
+
+#include "engine.h"
+#include "band_cache.h"
+#include "sample.h"
+#include "file_stream.h"
+#include "profile.h"
+
+
+  /*  In process interface to the beam statistics.  A caller opens a PFM (or hands over a handle it
+      already has open), accumulates, and finalizes to get a BEAMSTATS_RESULT:
+
+          BEAMSTATS_OPTIONS  options;
+          BEAMSTATS          *bs;
+          BEAMSTATS_RESULT   *result;
+
+          beamstats_default_options (&options);
+          if ((bs = beamstats_open (list_path, &options)) == NULL) ... pfm_error_str (pfm_error) ...
+          beamstats_accumulate (bs);
+          result = beamstats_finalize (bs);
+          ... result->stats.beams.beam[i] ...
+          beamstats_free_result (result);
+
+      beamstats_sample can be called instead of beamstats_accumulate to get preview estimates along the
+      way (sample.h); the result is the same.
+
+      PFM errors, threads that can't be started, and failures to allocate the results are returned rather
+      than exiting so that a long running service can carry on.  Running out of memory for the per band
+      accumulators part way through a run (beam_table.c, resid_sketch.c, and so on) still exits.  */
+
+
+  typedef struct
+  {
+    int32_t       threads;             /*  worker threads, each with its own handle */
+    int32_t       queue_depth;         /*  rows of read ahead per worker (0 = none) */
+    int32_t       queue_mb;            /*  read ahead memory limit per worker (MB)  */
+    NV_BOOL       stream;              /*  stream the PFM files in the background   */
+    NV_BOOL       progress;            /*  print percent processed on stderr        */
+    NV_BOOL       profiling;           /*  collect PROFILE counters                 */
+    char          *cache_path;         /*  band cache file (band_cache.h) or NULL   */
+    REGION        *region;             /*  part of the grid to process or NULL      */
+    int32_t       tile_size;           /*  per tile totals for size x size tiles    */
+    NV_BOOL       line_stats;          /*  per line and beam statistics             */
+    NV_BOOL       counts_only;         /*  edit counts and coverage only            */
+    NV_BOOL       quantiles;           /*  per beam residual percentiles            */
+    NV_BOOL       tvu;                 /*  count residuals within the IHO TVU       */
+    double        tvu_a;               /*  TVU constant part (m)                    */
+    double        tvu_b;               /*  TVU depth dependent factor               */
+    int32_t       num_depth_edges;     /*  depth band boundaries (0 = none)         */
+    float         *depth_edges;        /*  increasing boundary depths (m)           */
+    char          *raster_path;        /*  per bin QC GeoTIFF (raster.h) or NULL    */
+  } BEAMSTATS_OPTIONS;
+
+
+  /*  Everything the report is made from.  The per beam counts are in stats.beams.beam[i] (beam i + 1)
+      and the residual moments in stats.beams.beam[i].resid (see resid_stats.h).  */
+
+  typedef struct
+  {
+    char          list_path[1024];     /*  PFM handle or list file                  */
+    int32_t       width;               /*  bin_width                                */
+    int32_t       height;              /*  bin_height                               */
+    double        bin_size_xy;         /*  bin size in meters                       */
+    NV_F64_XYMBR  mbr;                 /*  grid bounds                              */
+    double        x_bin_size_degrees;
+    double        y_bin_size_degrees;
+    REGION        region;              /*  window processed (no spans)              */
+    NV_BOOL       subset;              /*  only part of the grid was processed      */
+    int32_t       runs;                /*  PFM results merged into this one         */
+    BEAM_STATS    stats;               /*  per beam records, totals, tiles, lines   */
+    int32_t       num_lines;           /*  lines in stats.lines                     */
+    int32_t       *line;               /*  their line numbers (table key order)     */
+    char          **line_name;         /*  and their file names                     */
+    int64_t       grand_total;         /*  total_bad + total_good                   */
+    double        square_kilometers;   /*  area of bins with good data              */
+    double        square_nmiles;
+    double        s2_kilos;            /*  area of bins with good data from 2 or    */
+    double        s2_nmiles;           /*  more lines (200% or better)              */
+    double        coverage_kilos[COVERAGE_LEVELS];     /*  area with good data from at  */
+    double        coverage_nmiles[COVERAGE_LEVELS];    /*  least n + 1 lines            */
+    int32_t       threads;             /*  threads actually used                    */
+    int32_t       queue_depth;
+    int64_t       stream_bytes;        /*  bytes read by --stream                   */
+    int32_t       stream_skipped;      /*  files too big for --stream to read       */
+    int32_t       num_bands;           /*  BAND_ROWS row bands in the file          */
+    int32_t       cached_bands;        /*  bands merged from the band cache         */
+    NV_BOOL       cache_saved;         /*  band cache was written                   */
+    NV_BOOL       raster_saved;        /*  QC raster was written                    */
+    PROFILE       profile;             /*  only filled in when profiling            */
+  } BEAMSTATS_RESULT;
+
+
+  typedef struct
+  {
+    BEAMSTATS_OPTIONS options;
+    PFM_OPEN_ARGS open_args;
+    int32_t       pfm_handle[MAX_THREADS];
+    int32_t       num_handles;
+    NV_BOOL       owns_handles;        /*  closed by beamstats_finalize             */
+    FILE_STREAM   stream;
+    NV_BOOL       streaming;
+    BEAM_STATS    *total;              /*  NULL until beamstats_accumulate          */
+    NV_BOOL       failed;              /*  the engine failed, there's no total      */
+    int32_t       cached_bands;
+    NV_BOOL       cache_saved;
+    NV_BOOL       raster_saved;
+    PROFILE       profile;
+  } BEAMSTATS;
+
+
+  /*  Called by beamstats_sample with each preview estimate (which is freed when it returns).  */
+
+  typedef void (*SAMPLE_CALLBACK) (SAMPLE_ESTIMATE *estimate, void *data);
+
+
+  void beamstats_default_options (BEAMSTATS_OPTIONS *options);
+  BEAMSTATS *beamstats_open (char *list_path, BEAMSTATS_OPTIONS *options);
+  BEAMSTATS *beamstats_attach (int32_t pfm_handle, PFM_OPEN_ARGS *open_args, BEAMSTATS_OPTIONS *options);
+  int32_t beamstats_accumulate (BEAMSTATS *bs);
+  int32_t beamstats_sample (BEAMSTATS *bs, int32_t num_steps, double *fraction, SAMPLE_CALLBACK callback,
+                            void *data);
+  BEAMSTATS_RESULT *beamstats_finalize (BEAMSTATS *bs);
+  BEAMSTATS_RESULT *beamstats_make_result (PFM_OPEN_ARGS *open_args, BEAM_STATS *total);
+  void beamstats_free_result (BEAMSTATS_RESULT *result);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
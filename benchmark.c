@@ -0,0 +1,452 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchmark.h"
+#include "band_cache.h"
+
+
+/*  Default grid sizes when none are given on the command line.  */
+
+static NV_I32_COORD2 default_sizes[] = {{256, 256}, {1024, 1024}, {2048, 2048}};
+
+
+/*  Default grid for --self-check.  The height isn't a multiple of BAND_ROWS so the last band is short.  */
+
+static NV_I32_COORD2 check_size = {500, 300};
+
+
+
+/*  Engine settings for a synthetic grid, with all of the optional statistics turned off.  */
+
+static void synth_options (ENGINE_OPTIONS *options, SYNTH_PARAMS *params)
+{
+    options->width = params->width;
+    options->height = params->height;
+    options->null_depth = 99999.0;
+    options->progress = NVFalse;
+    options->profiling = NVFalse;
+    options->band_stats = NULL;
+    options->keep_bands = NVFalse;
+    options->bands = NULL;
+    options->region = NULL;
+    options->tile_size = 0;
+    options->line_stats = NVFalse;
+    options->quantiles = NVFalse;
+    options->tvu = NVFalse;
+    options->num_depth_edges = 0;
+    options->bin_grid = NVFalse;
+    options->merge_band = NULL;
+    options->band_claimed = NULL;
+}
+
+
+
+/*  Time the statistics engine over synthetic grids of each size in "sizes" (or the default ladder if
+    num_sizes is 0) and print soundings per second.  Each size is run "repeat" times and the fastest run
+    is reported.  Generating the data isn't timed.  Only the threads, queue, and counts_only settings in
+    "options" are used.  */
+
+void run_benchmark (FILE *fp, SYNTH_PARAMS *params, int32_t num_sizes, NV_I32_COORD2 *sizes, int32_t repeat,
+                    ENGINE_OPTIONS *options)
+{
+    SYNTH_PARAMS            size_params;
+    SYNTH_SOURCE            synth;
+    BEAM_STATS              *stats;
+    void                    *sources[MAX_THREADS];
+    int32_t                 i, k, r;
+    int64_t                 start_ns, best_ns, ns, soundings;
+
+
+    if (!num_sizes)
+    {
+        num_sizes = sizeof (default_sizes) / sizeof (NV_I32_COORD2);
+        sizes = default_sizes;
+    }
+
+    if (repeat < 1) repeat = 1;
+
+
+    fprintf (fp, "#\n#Synthetic benchmark\n#\n");
+    fprintf (fp, "#Soundings per bin (mean):  %d\n", params->soundings_per_bin);
+    fprintf (fp, "#Beams:  %d\n#Lines:  %d\n", params->beams, params->lines);
+    fprintf (fp, "#Manual/filter/deleted/selected/modified/empty bin percent:  %.1f/%.1f/%.1f/%.1f/%.1f/%.1f\n",
+             params->manual_pct, params->filter_pct, params->deleted_pct, params->selected_pct,
+             params->modified_pct, params->empty_pct);
+    fprintf (fp, "#Threads:  %d\n#Read ahead:  %d rows\n#Best of:  %d\n#\n", options->threads,
+             options->queue_depth, repeat);
+    fprintf (fp, "#       GRID          BINS     SOUNDINGS      SECONDS     SOUNDINGS/S          BINS/S\n");
+    fprintf (fp, "#-----------  ------------  ------------  -----------  --------------  --------------\n");
+
+
+    for (i = 0 ; i < num_sizes ; i++)
+    {
+        size_params = *params;
+        size_params.width = sizes[i].x;
+        size_params.height = sizes[i].y;
+
+        if (synth_init (&synth, &size_params))
+        {
+            fprintf (stderr, "Unable to allocate the %dx%d synthetic grid\n", size_params.width, size_params.height);
+            return;
+        }
+
+        synth_options (options, &size_params);
+
+        for (k = 0 ; k < options->threads ; k++) sources[k] = &synth;
+
+
+        /*  Total soundings in the grid (rows repeat every synth.rows).  */
+
+        soundings = 0;
+        for (k = 0 ; k < size_params.height ; k++) soundings += synth.row[k % synth.rows].soundings.count;
+
+
+        best_ns = -1;
+
+        for (r = 0 ; r < repeat ; r++)
+        {
+            start_ns = profile_clock ();
+
+            if ((stats = run_engine (options, synth_read_row, sources, NULL)) == NULL)
+            {
+                fprintf (stderr, "Unable to run the engine (out of memory, or a thread couldn't be started)\n");
+                synth_free (&synth);
+                return;
+            }
+
+            ns = profile_clock () - start_ns;
+
+            free_beam_stats (stats);
+
+            if (best_ns < 0 || ns < best_ns) best_ns = ns;
+        }
+
+        if (best_ns < 1) best_ns = 1;
+
+        fprintf (fp, "%5dx%-6d  %12lld  %12lld  %11.3f  %14.0f  %14.0f\n", size_params.width, size_params.height,
+                 (long long) size_params.width * size_params.height, (long long) soundings,
+                 (double) best_ns * 1.0e-9, (double) soundings / ((double) best_ns * 1.0e-9),
+                 (double) size_params.width * size_params.height / ((double) best_ns * 1.0e-9));
+        fflush (fp);
+
+        synth_free (&synth);
+    }
+}
+
+
+
+/*  READ_ROW for --self-check.  The synthetic rows repeat every synth->rows rows, which would make every
+    band the same and hide a band merged out of order, so each repeat shifts the depths (and the bin
+    reference depths with them) and rotates the beam numbers.  */
+
+static int32_t check_read_row (void *source, int32_t row, ROW_BUFFER *buffer, PROFILE *profile)
+{
+    SYNTH_SOURCE            *synth = (SYNTH_SOURCE *) source;
+    SOUNDING_BUFFER         *soundings = &buffer->soundings;
+    int32_t                 j, m, repeat;
+    float                   shift;
+
+
+    synth_read_row (source, row, buffer, profile);
+
+    if (!(repeat = row / synth->rows)) return (0);
+
+    shift = (float) repeat * 0.37;
+
+    for (j = 0 ; j < buffer->width ; j++) buffer->bin[j].avg_filtered_depth += shift;
+
+    for (m = 0 ; m < soundings->count ; m++)
+    {
+        soundings->z[m] += shift;
+        soundings->beam[m] = (soundings->beam[m] + repeat) % synth->params.beams;
+    }
+
+    return (0);
+}
+
+
+
+static NV_BOOL same_store (SKETCH_STORE *a, SKETCH_STORE *b)
+{
+    return (a->offset == b->offset && a->size == b->size &&
+            (!a->size || !memcmp (a->count, b->count, a->size * sizeof (int64_t))));
+}
+
+
+
+/*  NVTrue if "a" and "b" hold exactly the same statistics (bit for bit, so a sum added up in a different
+    order shows up).  */
+
+static NV_BOOL same_stats (BEAM_STATS *a, BEAM_STATS *b)
+{
+    LINE_BEAM               *sa, *sb;
+    NV_BOOL                 same;
+    int32_t                 i;
+
+
+    if (a->total_filter != b->total_filter || a->total_manual != b->total_manual || a->total_pfm != b->total_pfm ||
+        a->total_bad != b->total_bad || a->total_good != b->total_good || a->total_select != b->total_select ||
+        a->bin_count != b->bin_count || a->bin2_count != b->bin2_count || a->bad_beams != b->bad_beams ||
+        a->read_errors != b->read_errors || memcmp (a->coverage, b->coverage, sizeof (a->coverage)))
+        return (NVFalse);
+
+    if (a->beams.size != b->beams.size ||
+        memcmp (a->beams.beam, b->beams.beam, a->beams.size * sizeof (BEAM_RECORD)) ||
+        memcmp (a->beams.count, b->beams.count, a->beams.size * sizeof (BEAM_COUNTS)))
+        return (NVFalse);
+
+    if (a->tiles.rows != b->tiles.rows || a->tiles.columns != b->tiles.columns ||
+        memcmp (a->tiles.tile, b->tiles.tile, (size_t) a->tiles.rows * a->tiles.columns * sizeof (TILE_STATS)))
+        return (NVFalse);
+
+    if (a->sketches.size != b->sketches.size) return (NVFalse);
+
+    for (i = 0 ; i < a->sketches.size ; i++)
+    {
+        if (a->sketches.sketch[i].count != b->sketches.sketch[i].count ||
+            a->sketches.sketch[i].zero != b->sketches.sketch[i].zero ||
+            !same_store (&a->sketches.sketch[i].pos, &b->sketches.sketch[i].pos) ||
+            !same_store (&a->sketches.sketch[i].neg, &b->sketches.sketch[i].neg)) return (NVFalse);
+    }
+
+    if (a->depths.num_edges != b->depths.num_edges || a->depths.beams != b->depths.beams ||
+        (a->depths.beams && memcmp (a->depths.cell, b->depths.cell,
+                                    (size_t) a->depths.beams * (a->depths.num_edges + 1) * sizeof (RESID_STATS))))
+        return (NVFalse);
+
+    if (a->lines.size != b->lines.size) return (NVFalse);
+    if (!a->lines.size) return (NVTrue);
+
+    sa = line_table_sort (&a->lines);
+    sb = line_table_sort (&b->lines);
+
+    same = !memcmp (sa, sb, a->lines.size * sizeof (LINE_BEAM));
+
+    free (sa);
+    free (sb);
+
+    return (same);
+}
+
+
+
+/*  Run the engine over "synth" with "threads" workers and "queue_depth" rows of read ahead.  */
+
+static BEAM_STATS *check_run (SYNTH_SOURCE *synth, ENGINE_OPTIONS *options, int32_t threads, int32_t queue_depth)
+{
+    void                    *sources[MAX_THREADS];
+    int32_t                 k;
+
+
+    options->threads = threads;
+    options->queue_depth = queue_depth;
+
+    for (k = 0 ; k < threads ; k++) sources[k] = synth;
+
+    return (run_engine (options, check_read_row, sources, NULL));
+}
+
+
+
+/*  Print and count one comparison against "reference" (and free "stats").  */
+
+static int32_t check_result (FILE *fp, char *name, BEAM_STATS *reference, BEAM_STATS *stats)
+{
+    NV_BOOL                 same;
+
+
+    if (stats == NULL)
+    {
+        fprintf (fp, "%-56s  engine failed\n", name);
+        return (1);
+    }
+
+    same = same_stats (reference, stats);
+
+    fprintf (fp, "%-56s  %s\n", name, same ? "same" : "DIFFERENT");
+    fflush (fp);
+
+    free_beam_stats (stats);
+
+    return (!same);
+}
+
+
+
+/*  Checks that the results don't depend on how they were computed.  A synthetic grid (the first of
+    "sizes", or check_size) is run with one thread and no read ahead, and then with options->threads
+    workers (4 if that's 1) and options->queue_depth rows of read ahead (4 if that's 0), with and without
+    all of the optional statistics, and through a band cache written to and read back from "cache_path"
+    (which is removed afterwards).  Every result has to match the single thread one exactly.  Returns the
+    number of checks that failed.  */
+
+int32_t run_self_check (FILE *fp, SYNTH_PARAMS *params, int32_t num_sizes, NV_I32_COORD2 *sizes,
+                        ENGINE_OPTIONS *options, char *cache_path)
+{
+    SYNTH_PARAMS            check_params;
+    SYNTH_SOURCE            synth;
+    BAND_CACHE              cache;
+    BEAM_STATS              *reference;
+    float                   edges[2] = {22.0, 26.0};
+    int32_t                 i, pass, threads, queue_depth, failed = 0;
+    char                    name[128];
+
+
+    check_params = *params;
+    check_params.width = num_sizes ? sizes[0].x : check_size.x;
+    check_params.height = num_sizes ? sizes[0].y : check_size.y;
+
+    threads = options->threads > 1 ? options->threads : 4;
+    queue_depth = options->queue_depth > 0 ? options->queue_depth : 4;
+
+    if (synth_init (&synth, &check_params))
+    {
+        fprintf (fp, "Unable to allocate the %dx%d synthetic grid\n", check_params.width, check_params.height);
+        return (1);
+    }
+
+    fprintf (fp, "#\n#Self check (%dx%d synthetic grid, %d threads, %d rows of read ahead)\n#\n", check_params.width,
+             check_params.height, threads, queue_depth);
+
+
+    /*  Plain counts and repeatability.  */
+
+    synth_options (options, &check_params);
+    options->counts_only = NVFalse;
+
+    if ((reference = check_run (&synth, options, 1, 0)) == NULL)
+    {
+        fprintf (fp, "Unable to run the engine (out of memory, or a thread couldn't be started)\n");
+        synth_free (&synth);
+        return (1);
+    }
+
+    sprintf (name, "%d threads", threads);
+    failed += check_result (fp, name, reference, check_run (&synth, options, threads, queue_depth));
+
+    sprintf (name, "%d threads, rows read by the workers", threads);
+    failed += check_result (fp, name, reference, check_run (&synth, options, threads, 0));
+
+
+    /*  The band cache, written and then read back whole and with every third band stale.  */
+
+    band_cache_init (&cache, check_params.height);
+
+    options->band_stats = cache.stats;
+    options->keep_bands = NVTrue;
+
+    sprintf (name, "%d threads, filling the band cache", threads);
+    failed += check_result (fp, name, reference, check_run (&synth, options, threads, queue_depth));
+
+    if (band_cache_save (&cache, cache_path, check_params.width, check_params.height, options->null_depth))
+    {
+        fprintf (fp, "%-56s  unable to write %s\n", "band cache", cache_path);
+        failed++;
+    }
+
+    band_cache_free (&cache);
+
+    for (pass = 0 ; pass < 2 ; pass++)
+    {
+        band_cache_init (&cache, check_params.height);
+
+        if (band_cache_load (&cache, cache_path, check_params.width, check_params.height, options->null_depth) !=
+            cache.num_bands)
+        {
+            fprintf (fp, "%-56s  unable to read %s\n", "band cache", cache_path);
+            failed++;
+            band_cache_free (&cache);
+            break;
+        }
+
+        for (i = 0 ; pass && i < cache.num_bands ; i += 3)
+        {
+            free_beam_stats (cache.stats[i]);
+            cache.stats[i] = NULL;
+        }
+
+        options->band_stats = cache.stats;
+
+        sprintf (name, pass ? "%d threads, band cache with stale bands" : "%d threads, every band from the cache",
+                 threads);
+        failed += check_result (fp, name, reference, check_run (&synth, options, threads, queue_depth));
+
+        band_cache_free (&cache);
+    }
+
+    remove (cache_path);
+
+    options->band_stats = NULL;
+    options->keep_bands = NVFalse;
+
+    free_beam_stats (reference);
+
+
+    /*  Everything else that's merged band by band.  */
+
+    options->tile_size = 64;
+    options->line_stats = NVTrue;
+    options->quantiles = NVTrue;
+    options->tvu = NVTrue;
+    options->tvu_a = 0.25;
+    options->tvu_b = 0.0075;
+    options->num_depth_edges = 2;
+    options->depth_edges = edges;
+
+    if ((reference = check_run (&synth, options, 1, 0)) != NULL)
+    {
+        sprintf (name, "%d threads, tiles, lines, percentiles, TVU, depth bands", threads);
+        failed += check_result (fp, name, reference, check_run (&synth, options, threads, queue_depth));
+        free_beam_stats (reference);
+    }
+    else
+    {
+        failed++;
+    }
+
+    synth_options (options, &check_params);
+    options->counts_only = NVTrue;
+
+    if ((reference = check_run (&synth, options, 1, 0)) != NULL)
+    {
+        sprintf (name, "%d threads, counts only", threads);
+        failed += check_result (fp, name, reference, check_run (&synth, options, threads, queue_depth));
+        free_beam_stats (reference);
+    }
+    else
+    {
+        failed++;
+    }
+
+    options->counts_only = NVFalse;
+
+    synth_free (&synth);
+
+    fprintf (fp, "#\n#%d check%s failed\n", failed, failed == 1 ? "" : "s");
+
+    return (failed);
+}
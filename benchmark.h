@@ -0,0 +1,58 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdio.h>
+
+#include "nvutility.h"
+
+#include "engine.h"
+#include "synthetic.h"
+
+
+#define       MAX_BENCH_SIZES      16
+
+
+  /*  Scratch band cache written (and removed) by run_self_check.  */
+
+#define       CHECK_CACHE_PATH     "pfm_beamstats_check.bscache"
+
+
+  void run_benchmark (FILE *fp, SYNTH_PARAMS *params, int32_t num_sizes, NV_I32_COORD2 *sizes, int32_t repeat,
+                      ENGINE_OPTIONS *options);
+  int32_t run_self_check (FILE *fp, SYNTH_PARAMS *params, int32_t num_sizes, NV_I32_COORD2 *sizes,
+                          ENGINE_OPTIONS *options, char *cache_path);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
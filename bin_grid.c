@@ -0,0 +1,59 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bin_grid.h"
+
+
+void bin_grid_init (BIN_GRID *grid, int32_t x0, int32_t y0, int32_t width, int32_t rows)
+{
+    int64_t                 i, count;
+
+
+    grid->x0 = x0;
+    grid->y0 = y0;
+    grid->width = width;
+    grid->rows = rows;
+
+    count = (int64_t) BIN_GRID_LAYERS * rows * width;
+
+    if ((grid->value = (float *) malloc (count * sizeof (float))) == NULL)
+    {
+        perror ("Allocating bin grid");
+        exit (-1);
+    }
+
+    for (i = 0 ; i < count ; i++) grid->value[i] = BIN_GRID_NODATA;
+}
+
+
+
+void bin_grid_free (BIN_GRID *grid)
+{
+    if (grid->value) free (grid->value);
+
+    memset (grid, 0, sizeof (BIN_GRID));
+}
@@ -0,0 +1,78 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+#ifndef __BIN_GRID_H__
+#define __BIN_GRID_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdint.h>
+
+
+  /*  Per bin QC values for the raster output (raster.h), one layer of each.  Bins without any soundings
+      (or outside of a polygon) are BIN_GRID_NODATA in every layer, and bins without residuals (no good
+      soundings or no PFM_DATA) are BIN_GRID_NODATA in the residual layers.  */
+
+#define       BIN_GRID_LAYERS      4
+#define       BIN_GRID_NODATA      -9999.0
+
+#define       BIN_GRID_RMS         0   /*  RMS residual                                     */
+#define       BIN_GRID_MAX         1   /*  maximum absolute residual                        */
+#define       BIN_GRID_EDITED      2   /*  manual and filter edits / all undeleted soundings */
+#define       BIN_GRID_LINES       3   /*  distinct lines with good data (up to             */
+                                       /*  COVERAGE_LEVELS, engine.h)                       */
+
+
+  /*  The layers for rows y0 through y0 + rows - 1 of columns x0 through x0 + width - 1 (one band of a
+      run's region).  Each band's block is written out as soon as it's merged, so only the bands in
+      flight are ever held (run_engine hands out no more than 2 x threads bands past the next one to be
+      merged when it's filling these).  */
+
+  typedef struct
+  {
+    int32_t       x0, y0;              /*  grid column and row of the first cell    */
+    int32_t       width;               /*  columns                                  */
+    int32_t       rows;                /*  rows                                     */
+    float         *value;              /*  layer * rows * width + row * width + col */
+  } BIN_GRID;
+
+
+  void bin_grid_init (BIN_GRID *grid, int32_t x0, int32_t y0, int32_t width, int32_t rows);
+  void bin_grid_free (BIN_GRID *grid);
+
+
+  /*  Row "row" (grid row, not offset) of "layer".  */
+
+  static inline float *bin_grid_row (BIN_GRID *grid, int32_t layer, int32_t row)
+  {
+    return (&grid->value[((int64_t) layer * grid->rows + row - grid->y0) * grid->width]);
+  }
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,200 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <string.h>
+
+#if defined (__AVX2__)
+#include <immintrin.h>
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "nvutility.h"
+
+#include "pfm.h"
+
+#include "classify.h"
+
+
+/*  Branch free classification of "count" soundings.  Every sounding gets a SOUNDING_* class byte in
+    sounding_class and the per class totals for the block are returned in counts.  The AVX2 (8 wide) or
+    SSE2 (4 wide) path is used if the compiler was told it could (e.g. -mavx2), otherwise the scalar
+    loop does the whole block.  The scalar loop also handles whatever is left over at the end.  */
+
+void classify_soundings (const uint32_t *validity, const float *z, int32_t count, float null_depth,
+                         uint8_t *sounding_class, CLASS_COUNTS *counts)
+{
+    int32_t                 m = 0;
+    uint32_t                v, counted, manual, filter, good, modified, selected, c;
+
+
+    memset (counts, 0, sizeof (CLASS_COUNTS));
+
+
+#if defined (__AVX2__)
+
+    {
+        __m256i zero = _mm256_setzero_si256 (), ones = _mm256_set1_epi32 (-1);
+        __m256i deleted_bit = _mm256_set1_epi32 (PFM_DELETED), manual_bit = _mm256_set1_epi32 (PFM_MANUALLY_INVAL);
+        __m256i filter_bit = _mm256_set1_epi32 (PFM_FILTER_INVAL), modified_bit = _mm256_set1_epi32 (PFM_MODIFIED);
+        __m256i selected_bit = _mm256_set1_epi32 (PFM_SELECTED_SOUNDING);
+        __m256 null_z = _mm256_set1_ps (null_depth);
+        __m256i n_counted = zero, n_manual = zero, n_filter = zero, n_good = zero, n_modified = zero,
+            n_selected = zero;
+        __m256i vv, mc, mm, mf, mg, mo, ms, cl;
+        __m128i lo, hi, packed;
+        int32_t lanes[8], i;
+
+
+        for ( ; m + 8 <= count ; m += 8)
+        {
+            vv = _mm256_loadu_si256 ((const __m256i *) &validity[m]);
+
+            mc = _mm256_cmpeq_epi32 (_mm256_and_si256 (vv, deleted_bit), zero);
+            mm = _mm256_andnot_si256 (_mm256_cmpeq_epi32 (_mm256_and_si256 (vv, manual_bit), zero), mc);
+            mf = _mm256_or_si256 (_mm256_xor_si256 (_mm256_cmpeq_epi32 (_mm256_and_si256 (vv, filter_bit), zero), ones),
+                                  _mm256_castps_si256 (_mm256_cmp_ps (_mm256_loadu_ps (&z[m]), null_z, _CMP_GE_OQ)));
+            mf = _mm256_andnot_si256 (mm, _mm256_and_si256 (mf, mc));
+            mg = _mm256_andnot_si256 (_mm256_or_si256 (mm, mf), mc);
+            mo = _mm256_andnot_si256 (_mm256_cmpeq_epi32 (_mm256_and_si256 (vv, modified_bit), zero), mc);
+            ms = _mm256_andnot_si256 (_mm256_cmpeq_epi32 (_mm256_and_si256 (vv, selected_bit), zero), mg);
+
+            n_counted = _mm256_sub_epi32 (n_counted, mc);
+            n_manual = _mm256_sub_epi32 (n_manual, mm);
+            n_filter = _mm256_sub_epi32 (n_filter, mf);
+            n_good = _mm256_sub_epi32 (n_good, mg);
+            n_modified = _mm256_sub_epi32 (n_modified, mo);
+            n_selected = _mm256_sub_epi32 (n_selected, ms);
+
+            cl = _mm256_or_si256 (_mm256_and_si256 (mc, _mm256_set1_epi32 (SOUNDING_COUNTED)),
+                                  _mm256_and_si256 (mm, _mm256_set1_epi32 (SOUNDING_MANUAL)));
+            cl = _mm256_or_si256 (cl, _mm256_and_si256 (mf, _mm256_set1_epi32 (SOUNDING_FILTER)));
+            cl = _mm256_or_si256 (cl, _mm256_and_si256 (mg, _mm256_set1_epi32 (SOUNDING_GOOD)));
+            cl = _mm256_or_si256 (cl, _mm256_and_si256 (mo, _mm256_set1_epi32 (SOUNDING_MODIFIED)));
+            cl = _mm256_or_si256 (cl, _mm256_and_si256 (ms, _mm256_set1_epi32 (SOUNDING_SELECTED)));
+
+            lo = _mm256_castsi256_si128 (cl);
+            hi = _mm256_extracti128_si256 (cl, 1);
+            packed = _mm_packs_epi32 (lo, hi);
+            packed = _mm_packus_epi16 (packed, packed);
+            _mm_storel_epi64 ((__m128i *) &sounding_class[m], packed);
+        }
+
+#define SUM_LANES(acc, total) _mm256_storeu_si256 ((__m256i *) lanes, acc); \
+        for (i = 0 ; i < 8 ; i++) total += lanes[i];
+
+        SUM_LANES (n_counted, counts->counted);
+        SUM_LANES (n_manual, counts->manual);
+        SUM_LANES (n_filter, counts->filter);
+        SUM_LANES (n_good, counts->good);
+        SUM_LANES (n_modified, counts->modified);
+        SUM_LANES (n_selected, counts->selected);
+
+#undef SUM_LANES
+    }
+
+#elif defined (__SSE2__)
+
+    {
+        __m128i zero = _mm_setzero_si128 (), ones = _mm_set1_epi32 (-1);
+        __m128i deleted_bit = _mm_set1_epi32 (PFM_DELETED), manual_bit = _mm_set1_epi32 (PFM_MANUALLY_INVAL);
+        __m128i filter_bit = _mm_set1_epi32 (PFM_FILTER_INVAL), modified_bit = _mm_set1_epi32 (PFM_MODIFIED);
+        __m128i selected_bit = _mm_set1_epi32 (PFM_SELECTED_SOUNDING);
+        __m128 null_z = _mm_set1_ps (null_depth);
+        __m128i n_counted = zero, n_manual = zero, n_filter = zero, n_good = zero, n_modified = zero,
+            n_selected = zero;
+        __m128i vv, mc, mm, mf, mg, mo, ms, cl;
+        int32_t lanes[4], i, packed;
+
+
+        for ( ; m + 4 <= count ; m += 4)
+        {
+            vv = _mm_loadu_si128 ((const __m128i *) &validity[m]);
+
+            mc = _mm_cmpeq_epi32 (_mm_and_si128 (vv, deleted_bit), zero);
+            mm = _mm_andnot_si128 (_mm_cmpeq_epi32 (_mm_and_si128 (vv, manual_bit), zero), mc);
+            mf = _mm_or_si128 (_mm_xor_si128 (_mm_cmpeq_epi32 (_mm_and_si128 (vv, filter_bit), zero), ones),
+                               _mm_castps_si128 (_mm_cmpge_ps (_mm_loadu_ps (&z[m]), null_z)));
+            mf = _mm_andnot_si128 (mm, _mm_and_si128 (mf, mc));
+            mg = _mm_andnot_si128 (_mm_or_si128 (mm, mf), mc);
+            mo = _mm_andnot_si128 (_mm_cmpeq_epi32 (_mm_and_si128 (vv, modified_bit), zero), mc);
+            ms = _mm_andnot_si128 (_mm_cmpeq_epi32 (_mm_and_si128 (vv, selected_bit), zero), mg);
+
+            n_counted = _mm_sub_epi32 (n_counted, mc);
+            n_manual = _mm_sub_epi32 (n_manual, mm);
+            n_filter = _mm_sub_epi32 (n_filter, mf);
+            n_good = _mm_sub_epi32 (n_good, mg);
+            n_modified = _mm_sub_epi32 (n_modified, mo);
+            n_selected = _mm_sub_epi32 (n_selected, ms);
+
+            cl = _mm_or_si128 (_mm_and_si128 (mc, _mm_set1_epi32 (SOUNDING_COUNTED)),
+                               _mm_and_si128 (mm, _mm_set1_epi32 (SOUNDING_MANUAL)));
+            cl = _mm_or_si128 (cl, _mm_and_si128 (mf, _mm_set1_epi32 (SOUNDING_FILTER)));
+            cl = _mm_or_si128 (cl, _mm_and_si128 (mg, _mm_set1_epi32 (SOUNDING_GOOD)));
+            cl = _mm_or_si128 (cl, _mm_and_si128 (mo, _mm_set1_epi32 (SOUNDING_MODIFIED)));
+            cl = _mm_or_si128 (cl, _mm_and_si128 (ms, _mm_set1_epi32 (SOUNDING_SELECTED)));
+
+            cl = _mm_packs_epi32 (cl, cl);
+            cl = _mm_packus_epi16 (cl, cl);
+            packed = _mm_cvtsi128_si32 (cl);
+            memcpy (&sounding_class[m], &packed, 4);
+        }
+
+#define SUM_LANES(acc, total) _mm_storeu_si128 ((__m128i *) lanes, acc); \
+        for (i = 0 ; i < 4 ; i++) total += lanes[i];
+
+        SUM_LANES (n_counted, counts->counted);
+        SUM_LANES (n_manual, counts->manual);
+        SUM_LANES (n_filter, counts->filter);
+        SUM_LANES (n_good, counts->good);
+        SUM_LANES (n_modified, counts->modified);
+        SUM_LANES (n_selected, counts->selected);
+
+#undef SUM_LANES
+    }
+
+#endif
+
+
+    for ( ; m < count ; m++)
+    {
+        v = validity[m];
+
+        counted = !(v & PFM_DELETED);
+        manual = counted & !!(v & PFM_MANUALLY_INVAL);
+        filter = counted & !manual & (!!(v & PFM_FILTER_INVAL) | (z[m] >= null_depth));
+        good = counted & !manual & !filter;
+        modified = counted & !!(v & PFM_MODIFIED);
+        selected = good & !!(v & PFM_SELECTED_SOUNDING);
+
+        c = counted | (manual << 1) | (filter << 2) | (good << 3) | (modified << 4) | (selected << 5);
+        sounding_class[m] = (uint8_t) c;
+
+        counts->counted += counted;
+        counts->manual += manual;
+        counts->filter += filter;
+        counts->good += good;
+        counts->modified += modified;
+        counts->selected += selected;
+    }
+}
@@ -0,0 +1,67 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __CLASSIFY_H__
+#define __CLASSIFY_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdint.h>
+
+
+  /*  Class bits for a sounding.  A deleted sounding has no bits set.  Exactly one of MANUAL, FILTER, or
+      GOOD is set for every other sounding.  */
+
+#define       SOUNDING_COUNTED     0x01     /*  not PFM_DELETED                                        */
+#define       SOUNDING_MANUAL      0x02     /*  PFM_MANUALLY_INVAL                                     */
+#define       SOUNDING_FILTER      0x04     /*  PFM_FILTER_INVAL or null depth (and not manual)        */
+#define       SOUNDING_GOOD        0x08     /*  valid                                                  */
+#define       SOUNDING_MODIFIED    0x10     /*  PFM_MODIFIED                                           */
+#define       SOUNDING_SELECTED    0x20     /*  PFM_SELECTED_SOUNDING on a good sounding               */
+
+
+  /*  Number of soundings in a block with each class bit set.  */
+
+  typedef struct
+  {
+    int32_t       counted;
+    int32_t       manual;
+    int32_t       filter;
+    int32_t       good;
+    int32_t       modified;
+    int32_t       selected;
+  } CLASS_COUNTS;
+
+
+  void classify_soundings (const uint32_t *validity, const float *z, int32_t count, float null_depth,
+                           uint8_t *sounding_class, CLASS_COUNTS *counts);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,87 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "depth_stats.h"
+
+
+/*  "edge" has to hold num_edges increasing depths.  No cells are allocated until a beam is added.  */
+
+void depth_table_init (DEPTH_TABLE *table, int32_t num_edges, float *edge)
+{
+    memset (table, 0, sizeof (DEPTH_TABLE));
+
+    table->num_edges = num_edges;
+    memcpy (table->edge, edge, num_edges * sizeof (float));
+}
+
+
+
+void depth_table_free (DEPTH_TABLE *table)
+{
+    if (table->cell) free (table->cell);
+
+    memset (table, 0, sizeof (DEPTH_TABLE));
+}
+
+
+
+/*  Make room for "beam" (doubling, so the partial tables don't keep reallocating).  */
+
+void depth_table_grow (DEPTH_TABLE *table, int32_t beam)
+{
+    int32_t                 beams, bands = table->num_edges + 1, i;
+
+
+    for (beams = table->beams ? table->beams : 64 ; beams <= beam ; beams *= 2);
+
+    if ((table->cell = (RESID_STATS *) realloc (table->cell, (size_t) beams * bands * sizeof (RESID_STATS))) == NULL)
+    {
+        perror ("Allocating depth band table");
+        exit (-1);
+    }
+
+    for (i = table->beams * bands ; i < beams * bands ; i++) resid_stats_init (&table->cell[i]);
+
+    table->beams = beams;
+}
+
+
+
+/*  Add the cells in "part" to "total" (both set up with the same edges).  */
+
+void depth_table_merge (DEPTH_TABLE *total, DEPTH_TABLE *part)
+{
+    int32_t                 i, bands = part->num_edges + 1;
+
+
+    if (part->beams > total->beams) depth_table_grow (total, part->beams - 1);
+
+    for (i = 0 ; i < part->beams * bands ; i++)
+    {
+        if (part->cell[i].count) resid_stats_merge (&total->cell[i], &part->cell[i]);
+    }
+}
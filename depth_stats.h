@@ -0,0 +1,82 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __DEPTH_STATS_H__
+#define __DEPTH_STATS_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdint.h>
+
+#include "resid_stats.h"
+
+
+  /*  At most this many depth band boundaries (DEPTH_MAX_EDGES + 1 bands).  */
+
+#define       DEPTH_MAX_EDGES      15
+
+
+  /*  Repeatability statistics for each beam within each depth band (IHO S-44 orders, for instance, only
+      apply down to a certain depth).  Band 0 is everything shallower than edge[0], band k is edge[k - 1] to
+      edge[k], and band num_edges is everything from edge[num_edges - 1] down.  The cells for one beam are
+      kept together (cell[beam * (num_edges + 1) + band]) and the table only grows with the highest beam
+      number seen, so its size doesn't depend on how many soundings there are.  */
+
+  typedef struct
+  {
+    int32_t       num_edges;           /*  band boundaries (0 = no depth bands)     */
+    float         edge[DEPTH_MAX_EDGES]; /*  increasing boundary depths (m)         */
+    int32_t       beams;               /*  beams allocated                          */
+    RESID_STATS   *cell;               /*  beams x (num_edges + 1) statistics       */
+  } DEPTH_TABLE;
+
+
+  void depth_table_init (DEPTH_TABLE *table, int32_t num_edges, float *edge);
+  void depth_table_free (DEPTH_TABLE *table);
+  void depth_table_grow (DEPTH_TABLE *table, int32_t beam);
+  void depth_table_merge (DEPTH_TABLE *total, DEPTH_TABLE *part);
+
+
+  /*  Returns the statistics for "beam" (already checked against BEAM_TABLE_LIMIT) at "depth".  */
+
+  static inline RESID_STATS *depth_table_get (DEPTH_TABLE *table, int32_t beam, float depth)
+  {
+    int32_t       band;
+
+
+    for (band = 0 ; band < table->num_edges && depth >= table->edge[band] ; band++);
+
+    if (beam >= table->beams) depth_table_grow (table, beam);
+
+    return (&table->cell[beam * (table->num_edges + 1) + band]);
+  }
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,609 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "nvutility.h"
+
+#include "pfm.h"
+
+#include "engine.h"
+#include "classify.h"
+
+
+/*  The statistics an accumulation kernel collects beyond the edit counts and coverage, which every
+    kernel does.  ACCUMULATE_DIFFS is everything that needs the residuals.  */
+
+#define       ACCUMULATE_RESID      0x01   /*  per beam repeatability (RESID_STATS)         */
+#define       ACCUMULATE_TILES      0x02   /*  per tile totals                              */
+#define       ACCUMULATE_LINES      0x04   /*  per line and beam statistics                 */
+#define       ACCUMULATE_QUANTILES  0x08   /*  per beam residual sketches                   */
+#define       ACCUMULATE_TVU        0x10   /*  residuals within the TVU                     */
+#define       ACCUMULATE_GRID       0x20   /*  per bin raster layers                        */
+#define       ACCUMULATE_DEPTHS     0x40   /*  per beam and depth band statistics           */
+#define       ACCUMULATE_DIFFS      0x7f
+
+
+typedef void (*ACCUMULATE_KERNEL) (ROW_BUFFER *row, float null_depth, BEAM_STATS *stats, uint32_t features);
+
+
+/*  State shared by all of the worker threads.  */
+
+typedef struct
+{
+    ENGINE_OPTIONS          *options;
+    REGION                  region;          /* options->region or the whole grid             */
+    int32_t                 num_bands;       /* number of BAND_ROWS row bands in the region   */
+    int32_t                 num_claims;      /* bands to hand out (num_bands or num_listed)   */
+    int32_t                 next_band;       /* next band (or list entry) to be handed out    */
+    int32_t                 next_merge;      /* next band (or list entry) to be merged        */
+    int32_t                 max_ahead;       /* claims allowed past next_merge (0 = no limit) */
+    int32_t                 rows_done;       /* rows completed (for the percent display)      */
+    int32_t                 total_rows;      /* rows to be processed                          */
+    int32_t                 old_percent;     /* previous percent processed                    */
+    BEAM_STATS              **band_stats;    /* finished bands waiting to be merged           */
+    BEAM_STATS              *total;          /* merged results                                */
+    uint32_t                features;        /* ACCUMULATE_* bits for options                 */
+    ACCUMULATE_KERNEL       kernel;          /* the kernel for them                           */
+    NV_BOOL                 failed;          /* a thread or allocation failed, stop handing out */
+    pthread_mutex_t         mutex;
+    pthread_cond_t          merged;          /* next_merge moved (or failed was set)          */
+} SHARED_STATE;
+
+
+typedef struct
+{
+    SHARED_STATE            *shared;
+    ROW_READER              reader;          /* reads (or reads ahead) the worker's rows      */
+    PROFILE                 read_profile;    /* profile counters for the reads                */
+    PROFILE                 profile;         /* profile counters for the worker itself        */
+    NV_BOOL                 ready;           /* reader set up                                 */
+    NV_BOOL                 started;         /* running in its own thread                     */
+    pthread_t               thread;
+} WORKER;
+
+
+
+void init_beam_stats (BEAM_STATS *stats)
+{
+    memset (stats, 0, sizeof (BEAM_STATS));
+
+    beam_table_init (&stats->beams);
+}
+
+
+
+void free_beam_stats (BEAM_STATS *stats)
+{
+    beam_table_free (&stats->beams);
+    tile_grid_free (&stats->tiles);
+    line_table_free (&stats->lines);
+    sketch_table_free (&stats->sketches);
+    bin_grid_free (&stats->grid);
+    depth_table_free (&stats->depths);
+    free (stats);
+}
+
+
+
+/*  Add the band results in "part" to "total".  */
+
+void merge_beam_stats (BEAM_STATS *total, BEAM_STATS *part)
+{
+    int32_t                 i;
+
+
+    beam_table_merge (&total->beams, &part->beams);
+
+    total->total_filter += part->total_filter;
+    total->total_manual += part->total_manual;
+    total->total_pfm += part->total_pfm;
+    total->total_bad += part->total_bad;
+    total->total_good += part->total_good;
+    total->total_select += part->total_select;
+    total->bin_count += part->bin_count;
+    total->bin2_count += part->bin2_count;
+    for (i = 0 ; i < COVERAGE_LEVELS ; i++) total->coverage[i] += part->coverage[i];
+    total->bad_beams += part->bad_beams;
+    total->read_errors += part->read_errors;
+
+    tile_grid_merge (&total->tiles, &part->tiles);
+    if (part->lines.capacity) line_table_merge (&total->lines, &part->lines);
+    if (part->sketches.size) sketch_table_merge (&total->sketches, &part->sketches);
+    if (part->depths.num_edges) depth_table_merge (&total->depths, &part->depths);
+}
+
+
+
+#define KERNEL_NAME       accumulate_counts
+#define KERNEL_FEATURES   0
+#include "engine_kernel.h"
+
+#define KERNEL_NAME       accumulate_resid
+#define KERNEL_FEATURES   ACCUMULATE_RESID
+#include "engine_kernel.h"
+
+#define KERNEL_NAME       accumulate_quantiles
+#define KERNEL_FEATURES   (ACCUMULATE_RESID | ACCUMULATE_QUANTILES)
+#include "engine_kernel.h"
+
+#define KERNEL_NAME       accumulate_tvu
+#define KERNEL_FEATURES   (ACCUMULATE_RESID | ACCUMULATE_TVU)
+#include "engine_kernel.h"
+
+#define KERNEL_NAME       accumulate_quantiles_tvu
+#define KERNEL_FEATURES   (ACCUMULATE_RESID | ACCUMULATE_QUANTILES | ACCUMULATE_TVU)
+#include "engine_kernel.h"
+
+#define KERNEL_NAME       accumulate_generic
+#define KERNEL_FEATURES   features
+#include "engine_kernel.h"
+
+
+/*  The specialized kernels.  Any other combination (tiles, lines, depth bands, or the raster, which cost
+    far more per sounding than the checks do) runs the generic kernel.  A new statistic only has to be added to the
+    template (and given a bit); the existing kernels compile exactly as before.  */
+
+static struct
+{
+    uint32_t                features;
+    ACCUMULATE_KERNEL       kernel;
+} kernels[] = {{0, accumulate_counts},
+               {ACCUMULATE_RESID, accumulate_resid},
+               {ACCUMULATE_RESID | ACCUMULATE_QUANTILES, accumulate_quantiles},
+               {ACCUMULATE_RESID | ACCUMULATE_TVU, accumulate_tvu},
+               {ACCUMULATE_RESID | ACCUMULATE_QUANTILES | ACCUMULATE_TVU, accumulate_quantiles_tvu}};
+
+
+
+static ACCUMULATE_KERNEL select_kernel (uint32_t features)
+{
+    uint32_t                i;
+
+
+    for (i = 0 ; i < sizeof (kernels) / sizeof (kernels[0]) ; i++)
+    {
+        if (kernels[i].features == features) return (kernels[i].kernel);
+    }
+
+    return (accumulate_generic);
+}
+
+
+
+/*  The ACCUMULATE_* bits for the band statistics that run_engine sets up from "options".  */
+
+static uint32_t options_features (ENGINE_OPTIONS *options)
+{
+    return ((options->counts_only ? 0 : ACCUMULATE_RESID) | (options->tile_size ? ACCUMULATE_TILES : 0) |
+            (options->line_stats ? ACCUMULATE_LINES : 0) | (options->quantiles ? ACCUMULATE_QUANTILES : 0) |
+            (options->tvu ? ACCUMULATE_TVU : 0) | (options->bin_grid ? ACCUMULATE_GRID : 0) |
+            (options->num_depth_edges ? ACCUMULATE_DEPTHS : 0));
+}
+
+
+
+/*  Accumulate the statistics for one row, with the kernel for whatever "stats" has been set up to
+    collect.  run_engine picks its kernel once up front instead.  */
+
+void accumulate_row (ROW_BUFFER *row, float null_depth, BEAM_STATS *stats)
+{
+    uint32_t                features;
+
+
+    features = (stats->counts_only ? 0 : ACCUMULATE_RESID) | (stats->tiles.tile ? ACCUMULATE_TILES : 0) |
+        (stats->lines.capacity ? ACCUMULATE_LINES : 0) | (stats->sketches.size ? ACCUMULATE_QUANTILES : 0) |
+        (stats->tvu ? ACCUMULATE_TVU : 0) | (stats->grid.value ? ACCUMULATE_GRID : 0) |
+        (stats->depths.num_edges ? ACCUMULATE_DEPTHS : 0);
+
+    (*select_kernel (features)) (row, null_depth, stats, features);
+}
+
+
+
+static void finish_band (SHARED_STATE *shared, int32_t band, int32_t rows, BEAM_STATS *stats);
+
+
+
+/*  Set up the optional per beam extras in a new "stats".  */
+
+static void init_options (ENGINE_OPTIONS *options, BEAM_STATS *stats)
+{
+    if (options->quantiles) sketch_table_init (&stats->sketches, 256);
+    if (options->num_depth_edges) depth_table_init (&stats->depths, options->num_depth_edges, options->depth_edges);
+
+    stats->counts_only = options->counts_only;
+    stats->tvu = options->tvu;
+    stats->tvu_a2 = options->tvu_a * options->tvu_a;
+    stats->tvu_b2 = options->tvu_b * options->tvu_b;
+}
+
+
+/*  Set up the tiles covering bin rows start_row through end_row - 1 (all of the region's tiles if
+    start_row is the region's first row and end_row its last).  */
+
+static void init_tiles (SHARED_STATE *shared, BEAM_STATS *stats, int32_t start_row, int32_t end_row)
+{
+    REGION                  *region = &shared->region;
+    int32_t                 size = shared->options->tile_size, first_row;
+
+
+    first_row = (start_row - region->y0) / size;
+
+    tile_grid_init (&stats->tiles, size, region->x0, region->y0, (region->x1 - region->x0 + size - 1) / size,
+                    first_row, (end_row - 1 - region->y0) / size - first_row + 1);
+}
+
+
+
+/*  Band number of the n'th band to be handed out (and merged).  */
+
+static inline int32_t band_number (SHARED_STATE *shared, int32_t n)
+{
+    return (shared->options->bands ? shared->options->bands[n] : n);
+}
+
+
+
+/*  Something couldn't be started or allocated.  No more bands are handed out, the ones already handed out
+    are finished (so every reader thread can run down), and run_engine returns NULL.  */
+
+static void engine_failed (SHARED_STATE *shared)
+{
+    pthread_mutex_lock (&shared->mutex);
+    shared->failed = NVTrue;
+    pthread_cond_broadcast (&shared->merged);
+    pthread_mutex_unlock (&shared->mutex);
+}
+
+
+
+/*  NEXT_BAND callback for the row readers.  Hands out bands in order (or in options->bands order).
+    Bands that already have a result in options->band_stats (from the band cache) are finished right here
+    without being read.
+
+    With shared->max_ahead set (for the raster, where every finished band holds a whole BIN_GRID until it
+    can be merged) a band isn't handed out until it's within max_ahead of the next band to be merged, so
+    one slow band can't leave the rest of the grid waiting in memory behind it.  This can't deadlock: the
+    band being waited for has already been handed out, and whoever has it only needs its own rows (a
+    reader claims a band only after it has read all of the previous one's).  */
+
+static NV_BOOL claim_band (void *data, int32_t *band, int32_t *start_row, int32_t *end_row)
+{
+    SHARED_STATE            *shared = (SHARED_STATE *) data;
+    BEAM_STATS              **band_stats = shared->options->band_stats;
+    int32_t                 n;
+
+
+    while (1)
+    {
+        pthread_mutex_lock (&shared->mutex);
+
+        while (shared->max_ahead && !shared->failed && shared->next_band < shared->num_claims &&
+               shared->next_band - shared->next_merge >= shared->max_ahead)
+            pthread_cond_wait (&shared->merged, &shared->mutex);
+
+        n = shared->failed ? shared->num_claims : shared->next_band++;
+
+        pthread_mutex_unlock (&shared->mutex);
+
+        if (n >= shared->num_claims) return (NVFalse);
+
+        if (shared->options->band_claimed)
+            (*shared->options->band_claimed) (shared->options->band_claimed_data, n + 1, shared->num_claims);
+
+        *band = band_number (shared, n);
+
+        *start_row = shared->region.y0 + *band * BAND_ROWS;
+        *end_row = *start_row + BAND_ROWS;
+        if (*end_row > shared->region.y1) *end_row = shared->region.y1;
+
+        if (band_stats == NULL || band_stats[*band] == NULL) break;
+
+        finish_band (shared, *band, *end_row - *start_row, band_stats[*band]);
+    }
+
+    return (NVTrue);
+}
+
+
+
+/*  Finished with a band.  Merges every finished band that is next in line into the total.  Merging
+    strictly in band (or list) order keeps the floating point sums (and therefore the report) identical no
+    matter how many threads are used.  */
+
+static void finish_band (SHARED_STATE *shared, int32_t band, int32_t rows, BEAM_STATS *stats)
+{
+    int32_t                 percent, next, merged;
+
+
+    pthread_mutex_lock (&shared->mutex);
+
+    shared->band_stats[band] = stats;
+
+    merged = shared->next_merge;
+
+    while (shared->next_merge < shared->num_claims &&
+           shared->band_stats[next = band_number (shared, shared->next_merge)] != NULL)
+    {
+        if (shared->options->merge_band)
+            (*shared->options->merge_band) (shared->options->merge_band_data, shared->band_stats[next]);
+
+        bin_grid_free (&shared->band_stats[next]->grid);
+
+        merge_beam_stats (shared->total, shared->band_stats[next]);
+
+        if (shared->options->band_stats && shared->options->keep_bands)
+        {
+            shared->options->band_stats[next] = shared->band_stats[next];
+        }
+        else
+        {
+            free_beam_stats (shared->band_stats[next]);
+            if (shared->options->band_stats) shared->options->band_stats[next] = NULL;
+        }
+
+        shared->band_stats[next] = NULL;
+        shared->next_merge++;
+    }
+
+    if (shared->next_merge != merged) pthread_cond_broadcast (&shared->merged);
+
+    shared->rows_done += rows;
+
+    percent = ((float) shared->rows_done / (float) shared->total_rows) * 100.0;
+    if (shared->options->progress && shared->old_percent != percent)
+    {
+        fprintf (stderr, "%03d%% processed     \r", percent);
+        shared->old_percent = percent;
+        fflush (stderr);
+    }
+
+    pthread_mutex_unlock (&shared->mutex);
+}
+
+
+
+/*  Worker thread.  Takes rows from its reader (which claims the bands), accumulates each band into its
+    own BEAM_STATS, and hands the band to finish_band after its last row.  */
+
+static void *band_worker (void *arg)
+{
+    WORKER                  *worker = (WORKER *) arg;
+    SHARED_STATE            *shared = worker->shared;
+    BEAM_STATS              *stats = NULL;
+    ROW_BUFFER              *row;
+    int32_t                 rows = 0, start_row, end_row;
+    int64_t                 start_ns = 0;
+
+
+    while (1)
+    {
+        if (shared->options->profiling && worker->reader.queue_depth) start_ns = profile_clock ();
+
+        if ((row = row_reader_next (&worker->reader)) == NULL) break;
+
+        if (shared->options->profiling && worker->reader.queue_depth) worker->profile.wait_ns += profile_clock () - start_ns;
+
+
+        if (stats == NULL)
+        {
+            if ((stats = (BEAM_STATS *) malloc (sizeof (BEAM_STATS))) == NULL)
+            {
+                engine_failed (shared);
+                row_reader_release (&worker->reader, row);
+                continue;
+            }
+
+            init_beam_stats (stats);
+            rows = 0;
+
+            start_row = shared->region.y0 + row->band * BAND_ROWS;
+            end_row = start_row + BAND_ROWS;
+            if (end_row > shared->region.y1) end_row = shared->region.y1;
+
+            if (shared->options->tile_size) init_tiles (shared, stats, start_row, end_row);
+            if (shared->options->line_stats) line_table_init (&stats->lines, 256);
+            init_options (shared->options, stats);
+
+            if (shared->options->bin_grid)
+                bin_grid_init (&stats->grid, shared->region.x0, start_row, shared->region.x1 - shared->region.x0,
+                               end_row - start_row);
+        }
+
+        if (shared->options->profiling) start_ns = profile_clock ();
+
+        (*shared->kernel) (row, shared->options->null_depth, stats, shared->features);
+        rows++;
+
+        if (shared->options->profiling) worker->profile.accumulate_ns += profile_clock () - start_ns;
+
+        if (row->last)
+        {
+            finish_band (shared, row->band, rows, stats);
+            stats = NULL;
+        }
+
+        row_reader_release (&worker->reader, row);
+    }
+
+    return (NULL);
+}
+
+
+
+/*  Run the whole grid through "threads" workers.  sources[i] is what worker i's read_row reads from (for
+    a PFM file each worker has its own handle).  Returns the merged statistics, which the caller frees
+    with free_beam_stats, or NULL if a thread couldn't be started or the band results couldn't be
+    allocated.  If "profile" isn't NULL the per thread counters are added to it.
+
+    If options->band_stats isn't NULL, bands with an entry there are merged without being read.  With
+    options->keep_bands every band's partial result is left in it (for the caller to free) instead of
+    being thrown away; otherwise each entry is freed (and cleared) as soon as it has been merged.
+
+    If options->bands isn't NULL only the options->num_listed bands in it are processed, and they are
+    merged in the order they are listed in.  */
+
+BEAM_STATS *run_engine (ENGINE_OPTIONS *options, READ_ROW read_row, void **sources, PROFILE *profile)
+{
+    BEAM_STATS              *total;
+    SHARED_STATE            shared;
+    WORKER                  *worker;
+    int32_t                 i, rows;
+    NV_BOOL                 failed;
+
+
+    if ((total = (BEAM_STATS *) malloc (sizeof (BEAM_STATS))) == NULL) return (NULL);
+
+    init_beam_stats (total);
+
+
+    shared.options = options;
+
+    if (options->region) shared.region = *options->region;
+    else region_grid (&shared.region, options->width, options->height);
+
+    if (options->tile_size) init_tiles (&shared, total, shared.region.y0, shared.region.y1);
+    if (options->line_stats) line_table_init (&total->lines, 256);
+    init_options (options, total);
+
+    shared.features = options_features (options);
+    shared.kernel = select_kernel (shared.features);
+
+    shared.num_bands = (shared.region.y1 - shared.region.y0 + BAND_ROWS - 1) / BAND_ROWS;
+    shared.num_claims = shared.num_bands;
+    shared.total_rows = shared.region.y1 - shared.region.y0;
+
+    if (options->bands)
+    {
+        shared.num_claims = options->num_listed;
+
+        for (i = 0, shared.total_rows = 0 ; i < options->num_listed ; i++)
+        {
+            rows = shared.region.y1 - shared.region.y0 - options->bands[i] * BAND_ROWS;
+            shared.total_rows += (rows < BAND_ROWS) ? rows : BAND_ROWS;
+        }
+    }
+
+    shared.next_band = 0;
+    shared.next_merge = 0;
+    shared.max_ahead = options->bin_grid ? 2 * options->threads : 0;
+    shared.rows_done = 0;
+    shared.old_percent = -1;
+    shared.total = total;
+    shared.failed = NVFalse;
+
+    if ((shared.band_stats = (BEAM_STATS **) calloc (shared.num_bands + 1, sizeof (BEAM_STATS *))) == NULL ||
+        (worker = (WORKER *) calloc (options->threads, sizeof (WORKER))) == NULL)
+    {
+        free (shared.band_stats);
+        free_beam_stats (total);
+        return (NULL);
+    }
+
+    pthread_mutex_init (&shared.mutex, NULL);
+    pthread_cond_init (&shared.merged, NULL);
+
+
+    for (i = 0 ; i < options->threads ; i++)
+    {
+        worker[i].shared = &shared;
+
+        if (row_reader_init (&worker[i].reader, read_row, sources[i], shared.region.x1 - shared.region.x0,
+                             options->region, options->queue_depth, options->queue_bytes, claim_band, &shared,
+                             options->profiling ? &worker[i].read_profile : NULL))
+        {
+            engine_failed (&shared);
+            break;
+        }
+
+        worker[i].ready = NVTrue;
+    }
+
+    for (i = 1 ; i < options->threads && worker[i].ready ; i++)
+    {
+        if (pthread_create (&worker[i].thread, NULL, band_worker, &worker[i]))
+        {
+            engine_failed (&shared);
+            break;
+        }
+
+        worker[i].started = NVTrue;
+    }
+
+
+    /*  Worker 0 runs here, and so (after a failure) does any worker whose thread didn't start, to use up
+        the rows its reader has already read ahead.  */
+
+    for (i = 0 ; i < options->threads ; i++)
+    {
+        if (worker[i].ready && !worker[i].started) band_worker (&worker[i]);
+    }
+
+    for (i = 1 ; i < options->threads ; i++)
+    {
+        if (worker[i].started) pthread_join (worker[i].thread, NULL);
+    }
+
+
+    for (i = 0 ; i < options->threads ; i++)
+    {
+        if (!worker[i].ready) continue;
+
+        row_reader_free (&worker[i].reader);
+
+        if (profile)
+        {
+            profile_add (profile, &worker[i].read_profile);
+            profile_add (profile, &worker[i].profile);
+        }
+    }
+
+    failed = shared.failed;
+
+    pthread_mutex_destroy (&shared.mutex);
+    pthread_cond_destroy (&shared.merged);
+    free (worker);
+
+
+    /*  After a failure some finished bands may still be waiting for one that never came.  */
+
+    if (failed)
+    {
+        for (i = 0 ; i <= shared.num_bands ; i++)
+        {
+            if (shared.band_stats[i]) free_beam_stats (shared.band_stats[i]);
+        }
+
+        free_beam_stats (total);
+        total = NULL;
+    }
+
+    free (shared.band_stats);
+
+    return (total);
+}
@@ -0,0 +1,149 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __ENGINE_H__
+#define __ENGINE_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include "nvutility.h"
+
+#include "beam_table.h"
+#include "tile_stats.h"
+#include "line_stats.h"
+#include "resid_sketch.h"
+#include "bin_grid.h"
+#include "depth_stats.h"
+#include "region.h"
+#include "row_reader.h"
+#include "profile.h"
+
+
+#define       MAX_THREADS          64
+
+
+  /*  Number of bin rows in each unit of work.  This is fixed (rather than derived from the number of
+      threads) so that the partial results are always merged in the same order and the report does not
+      depend on how many threads were used.  */
+
+#define       BAND_ROWS            16
+
+
+  /*  Coverage is counted up to this many distinct lines per bin (100% through 400%).  */
+
+#define       COVERAGE_LEVELS      4
+
+
+  /*  Everything accumulated while traversing the bins.  One of these is filled for each band of rows and
+      then merged into the running total.  */
+
+  typedef struct
+  {
+    BEAM_TABLE    beams;               /*  per beam counts and statistics           */
+    int64_t       total_filter;        /*  total filter edited                      */
+    int64_t       total_manual;        /*  total manual edited                      */
+    int64_t       total_pfm;           /*  total PFM bit set                        */
+    int64_t       total_bad;           /*  total number of edits for all beams      */
+    int64_t       total_good;          /*  total number of good depths for all beams */
+    int64_t       total_select;        /*  total number of selected soundings       */
+    int64_t       bin_count;           /*  bins with good data                      */
+    int64_t       bin2_count;          /*  bins with good data from 2 or more lines */
+    int64_t       bad_beams;           /*  soundings with out of range beam numbers */
+    int64_t       read_errors;         /*  bins that couldn't be read (left out)    */
+    int64_t       in_counters;         /*  soundings in the 32 bit beam counters    */
+    NV_BOOL       flushed;             /*  beam counts have been flushed (see       */
+                                       /*  BEAM_COUNTER_LIMIT)                      */
+    int64_t       coverage[COVERAGE_LEVELS];   /*  bins with good data from at least */
+                                               /*  n + 1 lines ([0] and [1] are the  */
+                                               /*  same as bin_count and bin2_count) */
+    TILE_GRID     tiles;               /*  per tile totals (tiles.size 0 = none)    */
+    LINE_TABLE    lines;               /*  per line and beam (capacity 0 = none)    */
+    SKETCH_TABLE  sketches;            /*  per beam quantiles (size 0 = none)       */
+    BIN_GRID      grid;                /*  per bin raster layers (value NULL = none) */
+    DEPTH_TABLE   depths;              /*  per beam and depth band (num_edges 0 = none) */
+    NV_BOOL       counts_only;         /*  no per beam repeatability statistics     */
+    NV_BOOL       tvu;                 /*  count residuals within the TVU limit     */
+    double        tvu_a2;              /*  square of the TVU constant (a)           */
+    double        tvu_b2;              /*  square of the TVU depth factor (b)       */
+  } BEAM_STATS;
+
+
+  /*  Called with each band's partial result, in band order, just before it's merged into the total (to
+      write out its bin grid, for instance).  */
+
+  typedef void (*MERGE_BAND) (void *data, BEAM_STATS *part);
+
+
+  /*  Called as the bands are handed out to be read, with the number handed out so far and the number to
+      be handed out in all (to keep --stream just ahead of the reads, for instance).  */
+
+  typedef void (*BAND_CLAIMED) (void *data, int32_t claimed, int32_t num_claims);
+
+
+  typedef struct
+  {
+    int32_t       width;               /*  bin_width                                */
+    int32_t       height;              /*  bin_height                               */
+    float         null_depth;          /*  null_depth from the PFM header           */
+    int32_t       threads;             /*  worker threads (one source each)         */
+    int32_t       queue_depth;         /*  rows of read ahead per worker            */
+    int64_t       queue_bytes;         /*  read ahead memory limit per worker       */
+    NV_BOOL       progress;            /*  print percent processed on stderr        */
+    NV_BOOL       profiling;           /*  collect PROFILE counters                 */
+    BEAM_STATS    **band_stats;        /*  optional, one per band (see run_engine)  */
+    NV_BOOL       keep_bands;          /*  leave merged bands in band_stats         */
+    int32_t       *bands;              /*  optional list of the bands to process    */
+    int32_t       num_listed;          /*  number of bands in the list              */
+    REGION        *region;             /*  part of the grid to process (NULL = all) */
+    int32_t       tile_size;           /*  per tile totals for size x size tiles    */
+    NV_BOOL       line_stats;          /*  per line and beam statistics             */
+    NV_BOOL       counts_only;         /*  skip the per beam repeatability          */
+    NV_BOOL       quantiles;           /*  per beam residual quantile sketches      */
+    NV_BOOL       tvu;                 /*  count residuals within the IHO TVU       */
+    double        tvu_a;               /*  TVU constant part (m)                    */
+    double        tvu_b;               /*  TVU depth dependent factor               */
+    NV_BOOL       bin_grid;            /*  fill in each band's per bin grid         */
+    int32_t       num_depth_edges;     /*  depth band boundaries (0 = none)         */
+    float         *depth_edges;        /*  increasing boundary depths (m)           */
+    MERGE_BAND    merge_band;          /*  optional, see MERGE_BAND                 */
+    void          *merge_band_data;
+    BAND_CLAIMED  band_claimed;        /*  optional, see BAND_CLAIMED               */
+    void          *band_claimed_data;
+  } ENGINE_OPTIONS;
+
+
+  void init_beam_stats (BEAM_STATS *stats);
+  void free_beam_stats (BEAM_STATS *stats);
+  void merge_beam_stats (BEAM_STATS *total, BEAM_STATS *part);
+  void accumulate_row (ROW_BUFFER *row, float null_depth, BEAM_STATS *stats);
+  BEAM_STATS *run_engine (ENGINE_OPTIONS *options, READ_ROW read_row, void **sources, PROFILE *profile);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,232 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+/*  Accumulation kernel template.  engine.c includes this once for each kernel, with KERNEL_NAME set to the
+    function's name and KERNEL_FEATURES to its mask of ACCUMULATE_* bits.  For the specialized kernels the
+    mask is a constant so the compiler drops the code for every statistic that isn't wanted; the generic
+    kernel passes "features" and checks at run time.  There's deliberately no include guard.
+
+    The whole row's soundings are classified in one pass (classify.c) and the file totals come straight
+    from the block counts.  The per sounding loop only has to scatter the class bits into the beam records
+    and do the coverage and repeatability work for good soundings.  */
+
+static void KERNEL_NAME (ROW_BUFFER *row, float null_depth, BEAM_STATS *stats, uint32_t features)
+{
+    SOUNDING_BUFFER         *soundings = &row->soundings;
+    BIN_VIEW                *bin_record;
+    BEAM_RECORD             *beam;
+    TILE_GRID               *tiles = &stats->tiles;
+    TILE_STATS              *tile = NULL, *tile_row = NULL;
+    LINE_TABLE              *lines = &stats->lines;
+    LINE_BEAM               *line_beam = NULL;
+    SKETCH_TABLE            *sketches = &stats->sketches;
+    BIN_GRID                *grid = &stats->grid;
+    CLASS_COUNTS            counts;
+    int32_t                 j, m;
+    uint32_t                c;
+    int32_t                 k, num_lines, bin_lines[COVERAGE_LEVELS], bin_soundings = 0, bin_edited = 0;
+    int32_t                 bin_resids = 0;
+    float                   diff, dep, bin_max = 0.0;
+    double                  bin_sum2 = 0.0;
+
+
+    (void) features;
+
+    stats->read_errors += row->read_errors;
+
+    if (!soundings->count) return;
+
+    if (stats->in_counters + soundings->count > BEAM_COUNTER_LIMIT)
+    {
+        beam_table_flush (&stats->beams);
+        stats->in_counters = 0;
+        stats->flushed = NVTrue;
+    }
+
+    stats->in_counters += soundings->count;
+
+    classify_soundings (soundings->validity, soundings->z, soundings->count, null_depth,
+                        soundings->sounding_class, &counts);
+
+    stats->total_pfm += counts.modified;                  /* PFM bit */
+    stats->total_manual += counts.manual;                 /* Manual */
+    stats->total_filter += counts.filter;                 /* Filter */
+    stats->total_bad += counts.manual + counts.filter;    /* edited */
+    stats->total_good += counts.good;                     /* good */
+    stats->total_select += counts.selected;               /* Selected */
+
+    if ((KERNEL_FEATURES) & ACCUMULATE_TILES)
+        tile_row = &tiles->tile[((row->row - tiles->y0) / tiles->size - tiles->first_row) * tiles->columns];
+
+
+    for (j = 0 ; j < row->width ; j++)
+    {
+        if (row->start[j] == row->start[j + 1]) continue;
+
+        bin_record = &row->bin[j];
+        num_lines = 0;
+
+        if ((KERNEL_FEATURES) & ACCUMULATE_GRID)
+        {
+            bin_soundings = bin_edited = bin_resids = 0;
+            bin_max = 0.0;
+            bin_sum2 = 0.0;
+        }
+
+        if ((KERNEL_FEATURES) & ACCUMULATE_TILES) tile = &tile_row[(row->column + j - tiles->x0) / tiles->size];
+
+        for (m = row->start[j] ; m < row->start[j + 1] ; m++)
+        {
+            c = soundings->sounding_class[m];
+
+            if (!c) continue;                                 /* PFM_DELETED */
+
+
+            if ((beam = beam_table_get (&stats->beams, soundings->beam[m])) == NULL)
+            {
+                /*  Take it back out of the totals.  */
+
+                stats->total_pfm -= (c >> 4) & 1;
+                stats->total_manual -= (c >> 1) & 1;
+                stats->total_filter -= (c >> 2) & 1;
+                stats->total_bad -= ((c >> 1) | (c >> 2)) & 1;
+                stats->total_good -= (c >> 3) & 1;
+                stats->total_select -= (c >> 5) & 1;
+                stats->bad_beams++;
+                continue;
+            }
+
+            beam->total_depths++;
+            beam->pfm += (c >> 4) & 1;
+            beam->manual += (c >> 1) & 1;
+            beam->filter += (c >> 2) & 1;
+            beam->bad += ((c >> 1) | (c >> 2)) & 1;
+            beam->good += (c >> 3) & 1;
+            beam->select += (c >> 5) & 1;
+
+            if ((KERNEL_FEATURES) & ACCUMULATE_GRID)
+            {
+                bin_soundings++;
+                bin_edited += ((c >> 1) | (c >> 2)) & 1;
+            }
+
+            if ((KERNEL_FEATURES) & ACCUMULATE_LINES)
+            {
+                line_beam = line_table_get (lines, soundings->line[m], soundings->beam[m]);
+                line_beam->total_depths++;
+                line_beam->good += (c >> 3) & 1;
+                line_beam->bad += ((c >> 1) | (c >> 2)) & 1;
+            }
+
+            if ((KERNEL_FEATURES) & ACCUMULATE_TILES)
+            {
+                tile->pfm += (c >> 4) & 1;
+                tile->manual += (c >> 1) & 1;
+                tile->filter += (c >> 2) & 1;
+                tile->bad += ((c >> 1) | (c >> 2)) & 1;
+                tile->good += (c >> 3) & 1;
+                tile->select += (c >> 5) & 1;
+            }
+
+
+            if (c & SOUNDING_GOOD)
+            {
+                /*  Count the distinct lines (up to COVERAGE_LEVELS of them, after that it doesn't matter).  */
+
+                if (num_lines < COVERAGE_LEVELS)
+                {
+                    for (k = 0 ; k < num_lines && bin_lines[k] != soundings->line[m] ; k++);
+
+                    if (k == num_lines) bin_lines[num_lines++] = soundings->line[m];
+                }
+
+
+                /*  Compute repeatability statistics.  */
+
+                if (((KERNEL_FEATURES) & ACCUMULATE_DIFFS) && (bin_record->validity & PFM_DATA))
+                {
+                    dep = soundings->z[m];
+                    diff = bin_record->avg_filtered_depth - dep;
+
+                    if ((KERNEL_FEATURES) & ACCUMULATE_RESID)
+                        resid_stats_add (&beam->resid, (double) diff, (double) dep);
+                    if ((KERNEL_FEATURES) & ACCUMULATE_TILES)
+                        resid_stats_add (&tile->resid, (double) diff, (double) dep);
+                    if ((KERNEL_FEATURES) & ACCUMULATE_LINES)
+                        resid_stats_add (&line_beam->resid, (double) diff, (double) dep);
+                    if ((KERNEL_FEATURES) & ACCUMULATE_QUANTILES)
+                        resid_sketch_add (sketch_table_get (sketches, soundings->beam[m]), (double) diff);
+                    if ((KERNEL_FEATURES) & ACCUMULATE_DEPTHS)
+                        resid_stats_add (depth_table_get (&stats->depths, soundings->beam[m], dep), (double) diff,
+                                         (double) dep);
+
+
+                    /*  IHO S-44 TVU is sqrt (a^2 + (b * depth)^2), compared squared.  */
+
+                    if (((KERNEL_FEATURES) & ACCUMULATE_TVU) &&
+                        (double) diff * diff <= stats->tvu_a2 + stats->tvu_b2 * dep * dep)
+                        beam->tvu_pass++;
+
+                    if ((KERNEL_FEATURES) & ACCUMULATE_GRID)
+                    {
+                        bin_resids++;
+                        bin_sum2 += (double) diff * diff;
+                        if (fabsf (diff) > bin_max) bin_max = fabsf (diff);
+                    }
+                }
+            }
+        }
+
+        if (num_lines)
+        {
+            for (k = 0 ; k < num_lines ; k++) stats->coverage[k]++;
+
+            stats->bin_count++;
+            stats->bin2_count += (num_lines > 1);
+
+            if ((KERNEL_FEATURES) & ACCUMULATE_TILES)
+            {
+                tile->bin_count++;
+                tile->bin2_count += (num_lines > 1);
+            }
+        }
+
+        if (((KERNEL_FEATURES) & ACCUMULATE_GRID) && bin_soundings)
+        {
+            k = row->column + j - grid->x0;
+
+            bin_grid_row (grid, BIN_GRID_EDITED, row->row)[k] = (float) bin_edited / (float) bin_soundings;
+            bin_grid_row (grid, BIN_GRID_LINES, row->row)[k] = (float) num_lines;
+
+            if (bin_resids)
+            {
+                bin_grid_row (grid, BIN_GRID_RMS, row->row)[k] = (float) sqrt (bin_sum2 / bin_resids);
+                bin_grid_row (grid, BIN_GRID_MAX, row->row)[k] = bin_max;
+            }
+        }
+    }
+}
+
+
+#undef KERNEL_NAME
+#undef KERNEL_FEATURES
@@ -0,0 +1,591 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+#include "export.h"
+#include "report.h"
+
+
+/*  The whole report is built in memory and written with a single fwrite.  */
+
+typedef struct
+{
+    char                    *data;
+    size_t                  size;
+    size_t                  capacity;
+} OUTPUT;
+
+
+static void output_reserve (OUTPUT *out, size_t bytes)
+{
+    if (out->size + bytes <= out->capacity) return;
+
+    while (out->size + bytes > out->capacity) out->capacity = out->capacity ? out->capacity * 2 : 65536;
+
+    if ((out->data = (char *) realloc (out->data, out->capacity)) == NULL)
+    {
+        perror ("Allocating report buffer");
+        exit (-1);
+    }
+}
+
+
+
+static void output_append (OUTPUT *out, const void *data, size_t bytes)
+{
+    output_reserve (out, bytes);
+    memcpy (&out->data[out->size], data, bytes);
+    out->size += bytes;
+}
+
+
+
+static void output_printf (OUTPUT *out, const char *format, ...)
+{
+    va_list                 args;
+    int32_t                 len;
+
+
+    va_start (args, format);
+    len = vsnprintf (NULL, 0, format, args);
+    va_end (args);
+
+    output_reserve (out, len + 1);
+
+    va_start (args, format);
+    vsnprintf (&out->data[out->size], len + 1, format, args);
+    va_end (args);
+
+    out->size += len;
+}
+
+
+
+/*  Full precision, or null (JSON) / empty (CSV) for a value that wasn't collected.  */
+
+static void output_double (OUTPUT *out, double value, const char *missing)
+{
+    if (isfinite (value)) output_printf (out, "%.17g", value);
+    else output_printf (out, "%s", missing);
+}
+
+
+
+static void json_string (OUTPUT *out, const char *string)
+{
+    const char              *c;
+
+
+    output_printf (out, "\"");
+
+    for (c = string ; *c ; c++)
+    {
+        if (*c == '"' || *c == '\\') output_printf (out, "\\%c", *c);
+        else if ((unsigned char) *c < 0x20) output_printf (out, "\\u%04x", *c);
+        else output_printf (out, "%c", *c);
+    }
+
+    output_printf (out, "\"");
+}
+
+
+
+static void csv_string (OUTPUT *out, const char *string)
+{
+    const char              *c;
+
+
+    output_printf (out, "\"");
+
+    for (c = string ; *c ; c++)
+    {
+        if (*c == '"') output_printf (out, "\"\"");
+        else output_printf (out, "%c", *c);
+    }
+
+    output_printf (out, "\"");
+}
+
+
+
+/*  "text", "json", "csv", or "binary".  Returns -1 for anything else.  */
+
+int32_t parse_format (char *name)
+{
+    if (!strcmp (name, "text")) return (FORMAT_TEXT);
+    if (!strcmp (name, "json")) return (FORMAT_JSON);
+    if (!strcmp (name, "csv")) return (FORMAT_CSV);
+    if (!strcmp (name, "binary")) return (FORMAT_BINARY);
+
+    return (-1);
+}
+
+
+
+/*  Report file name extension for "format".  */
+
+char *format_extension (int32_t format)
+{
+    switch (format)
+    {
+    case FORMAT_JSON:
+        return ("json");
+
+    case FORMAT_CSV:
+        return ("csv");
+
+    case FORMAT_BINARY:
+        return ("bin");
+    }
+
+    return ("txt");
+}
+
+
+
+/*  Fill in "record" for beam "i" (which has soundings).  */
+
+static void export_beam (BEAMSTATS_RESULT *result, int32_t i, EXPORT_BEAM *record)
+{
+    BEAM_RECORD             *beam = &result->stats.beams.beam[i];
+    BEAM_COUNTS             *count = &result->stats.beams.count[i];
+    RESID_SKETCH            *sketch;
+
+
+    memset (record, 0, sizeof (EXPORT_BEAM));
+
+    record->beam = i + 1;
+    record->total_depths = count->total_depths;
+    record->bad = count->bad;
+    record->good = count->good;
+    record->manual = count->manual;
+    record->filter = count->filter;
+    record->select = count->select;
+    record->pfm = count->pfm;
+    record->tvu_pass = count->tvu_pass;
+    record->count = beam->resid.count;
+    record->neg_count = beam->resid.neg_count;
+
+    if (beam->resid.count)
+    {
+        record->mean = beam->resid.mean;
+        record->std = sqrt (resid_stats_variance (&beam->resid));
+        record->rms = resid_stats_rms (&beam->resid);
+        record->mean_depth = beam->resid.mean_depth;
+        record->min_resid = beam->resid.min_val;
+        record->max_resid = beam->resid.max_val;
+        record->min_depth = beam->resid.min_depth;
+        record->max_depth = beam->resid.max_depth;
+    }
+    else
+    {
+        record->mean = record->std = record->rms = record->mean_depth = NAN;
+        record->min_resid = record->max_resid = record->min_depth = record->max_depth = NAN;
+    }
+
+    if (beam->resid.count && i < result->stats.sketches.size)
+    {
+        sketch = &result->stats.sketches.sketch[i];
+
+        record->median = resid_sketch_quantile (sketch, 0.5);
+        record->p95 = resid_sketch_abs_quantile (sketch, 0.95);
+        record->p99 = resid_sketch_abs_quantile (sketch, 0.99);
+    }
+    else
+    {
+        record->median = record->p95 = record->p99 = NAN;
+    }
+
+    if (!result->stats.tvu) record->tvu_pass = 0;
+}
+
+
+
+static void export_json (OUTPUT *out, BEAMSTATS_RESULT *result)
+{
+    BEAM_STATS              *total = &result->stats;
+    EXPORT_BEAM             record;
+    TILE_GRID               *tiles = &total->tiles;
+    TILE_STATS              *tile;
+    LINE_BEAM               *sorted, *line_beam;
+    DEPTH_TABLE             *depths = &total->depths;
+    RESID_STATS             *resid;
+    int32_t                 i, j, k, first;
+
+
+    output_printf (out, "{\n  \"file\": ");
+    json_string (out, result->list_path);
+    output_printf (out, ",\n  \"width\": %d,\n  \"height\": %d,\n  \"bin_size_m\": %.17g,\n", result->width,
+                   result->height, result->bin_size_xy);
+    output_printf (out, "  \"bounds\": {\"min_x\": %.17g, \"min_y\": %.17g, \"max_x\": %.17g, \"max_y\": %.17g},\n",
+                   result->mbr.min_x, result->mbr.min_y, result->mbr.max_x, result->mbr.max_y);
+    output_printf (out, "  \"region\": {\"x0\": %d, \"y0\": %d, \"x1\": %d, \"y1\": %d, \"subset\": %s},\n",
+                   result->region.x0, result->region.y0, result->region.x1, result->region.y1,
+                   result->subset ? "true" : "false");
+
+    output_printf (out, "  \"totals\": {\"soundings\": %lld, \"good\": %lld, \"bad\": %lld, \"manual\": %lld, "
+                   "\"filter\": %lld, \"pfm\": %lld, \"select\": %lld, \"bad_beams\": %lld, "
+                   "\"read_errors\": %lld},\n",
+                   (long long) result->grand_total, (long long) total->total_good, (long long) total->total_bad,
+                   (long long) total->total_manual, (long long) total->total_filter, (long long) total->total_pfm,
+                   (long long) total->total_select, (long long) total->bad_beams, (long long) total->read_errors);
+
+    output_printf (out, "  \"coverage\": [");
+    for (i = 0 ; i < COVERAGE_LEVELS ; i++)
+    {
+        output_printf (out, "%s\n    {\"percent\": %d, \"bins\": %lld, \"square_kilometers\": %.17g, "
+                       "\"square_nmiles\": %.17g}", i ? "," : "", (i + 1) * 100, (long long) total->coverage[i],
+                       result->coverage_kilos[i], result->coverage_nmiles[i]);
+    }
+    output_printf (out, "\n  ],\n");
+
+    if (total->tvu) output_printf (out, "  \"tvu\": {\"a\": %.17g, \"b\": %.17g},\n", sqrt (total->tvu_a2),
+                                   sqrt (total->tvu_b2));
+    else output_printf (out, "  \"tvu\": null,\n");
+
+
+    output_printf (out, "  \"beams\": [");
+
+    for (i = 0, first = 1 ; i < total->beams.size ; i++)
+    {
+        if (total->beams.count[i].total_depths <= 0) continue;
+
+        export_beam (result, i, &record);
+
+        output_printf (out, "%s\n    {\"beam\": %d, \"soundings\": %lld, \"good\": %lld, \"bad\": %lld, "
+                       "\"manual\": %lld, \"filter\": %lld, \"pfm\": %lld, \"select\": %lld, \"residuals\": %lld, "
+                       "\"negative\": %lld, ", first ? "" : ",", record.beam, (long long) record.total_depths,
+                       (long long) record.good, (long long) record.bad, (long long) record.manual,
+                       (long long) record.filter, (long long) record.pfm, (long long) record.select,
+                       (long long) record.count, (long long) record.neg_count);
+        output_printf (out, "\"rms\": ");
+        output_double (out, record.rms, "null");
+        output_printf (out, ", \"mean\": ");
+        output_double (out, record.mean, "null");
+        output_printf (out, ", \"std\": ");
+        output_double (out, record.std, "null");
+        output_printf (out, ", \"mean_depth\": ");
+        output_double (out, record.mean_depth, "null");
+        output_printf (out, ", \"min_resid\": ");
+        output_double (out, record.min_resid, "null");
+        output_printf (out, ", \"max_resid\": ");
+        output_double (out, record.max_resid, "null");
+        output_printf (out, ", \"min_depth\": ");
+        output_double (out, record.min_depth, "null");
+        output_printf (out, ", \"max_depth\": ");
+        output_double (out, record.max_depth, "null");
+        output_printf (out, ", \"median\": ");
+        output_double (out, record.median, "null");
+        output_printf (out, ", \"p95\": ");
+        output_double (out, record.p95, "null");
+        output_printf (out, ", \"p99\": ");
+        output_double (out, record.p99, "null");
+        if (total->tvu) output_printf (out, ", \"tvu_pass\": %lld", (long long) record.tvu_pass);
+        output_printf (out, "}");
+
+        first = 0;
+    }
+
+    output_printf (out, "\n  ]");
+
+
+    if (tiles->tile)
+    {
+        output_printf (out, ",\n  \"tile_size\": %d,\n  \"tiles\": [", tiles->size);
+
+        for (i = 0, first = 1 ; i < tiles->rows ; i++)
+        {
+            for (j = 0 ; j < tiles->columns ; j++)
+            {
+                tile = &tiles->tile[i * tiles->columns + j];
+
+                if (!tile->good && !tile->bad) continue;
+
+                output_printf (out, "%s\n    {\"x\": %d, \"y\": %d, \"bins\": %lld, \"bins_200\": %lld, "
+                               "\"good\": %lld, \"bad\": %lld, \"manual\": %lld, \"filter\": %lld, \"pfm\": %lld, "
+                               "\"select\": %lld, \"residuals\": %lld, \"rms\": ", first ? "" : ",", j,
+                               tiles->first_row + i, (long long) tile->bin_count, (long long) tile->bin2_count,
+                               (long long) tile->good, (long long) tile->bad, (long long) tile->manual,
+                               (long long) tile->filter, (long long) tile->pfm, (long long) tile->select,
+                               (long long) tile->resid.count);
+                output_double (out, tile->resid.count ? resid_stats_rms (&tile->resid) : NAN, "null");
+                output_printf (out, ", \"mean\": ");
+                output_double (out, tile->resid.count ? tile->resid.mean : NAN, "null");
+                output_printf (out, ", \"std\": ");
+                output_double (out, tile->resid.count ? sqrt (resid_stats_variance (&tile->resid)) : NAN, "null");
+                output_printf (out, "}");
+
+                first = 0;
+            }
+        }
+
+        output_printf (out, "\n  ]");
+    }
+
+
+    if (total->lines.capacity)
+    {
+        output_printf (out, ",\n  \"lines\": [");
+
+        for (i = 0 ; i < result->num_lines ; i++)
+        {
+            output_printf (out, "%s\n    {\"line\": %d, \"name\": ", i ? "," : "", result->line[i]);
+            json_string (out, result->line_name[i]);
+            output_printf (out, "}");
+        }
+
+        output_printf (out, "\n  ],\n  \"line_beams\": [");
+
+        sorted = line_table_sort (&total->lines);
+
+        for (i = 0 ; i < total->lines.size ; i++)
+        {
+            line_beam = &sorted[i];
+
+            output_printf (out, "%s\n    {\"line\": %d, \"beam\": %d, \"soundings\": %lld, \"good\": %lld, "
+                           "\"bad\": %lld, \"residuals\": %lld, \"negative\": %lld, \"rms\": ", i ? "," : "",
+                           (int16_t) (line_beam->key >> 16), (line_beam->key & 0xffff) + 1,
+                           (long long) line_beam->total_depths, (long long) line_beam->good,
+                           (long long) line_beam->bad, (long long) line_beam->resid.count,
+                           (long long) line_beam->resid.neg_count);
+            output_double (out, line_beam->resid.count ? resid_stats_rms (&line_beam->resid) : NAN, "null");
+            output_printf (out, ", \"mean\": ");
+            output_double (out, line_beam->resid.count ? line_beam->resid.mean : NAN, "null");
+            output_printf (out, ", \"std\": ");
+            output_double (out, line_beam->resid.count ? sqrt (resid_stats_variance (&line_beam->resid)) : NAN,
+                           "null");
+            output_printf (out, ", \"max_resid\": ");
+            output_double (out, line_beam->resid.count ? line_beam->resid.max_val : NAN, "null");
+            output_printf (out, ", \"mean_depth\": ");
+            output_double (out, line_beam->resid.count ? line_beam->resid.mean_depth : NAN, "null");
+            output_printf (out, "}");
+        }
+
+        free (sorted);
+
+        output_printf (out, "\n  ]");
+    }
+
+
+    if (depths->num_edges)
+    {
+        output_printf (out, ",\n  \"depth_edges\": [");
+        for (k = 0 ; k < depths->num_edges ; k++) output_printf (out, "%s%.9g", k ? ", " : "", depths->edge[k]);
+        output_printf (out, "],\n  \"depth_beams\": [");
+
+        for (k = 0, first = 1 ; k <= depths->num_edges ; k++)
+        {
+            for (i = 0 ; i < depths->beams ; i++)
+            {
+                resid = &depths->cell[i * (depths->num_edges + 1) + k];
+
+                if (!resid->count) continue;
+
+                output_printf (out, "%s\n    {\"band\": %d, \"beam\": %d, \"residuals\": %lld, \"negative\": %lld, "
+                               "\"rms\": ", first ? "" : ",", k, i + 1, (long long) resid->count,
+                               (long long) resid->neg_count);
+                output_double (out, resid_stats_rms (resid), "null");
+                output_printf (out, ", \"mean\": ");
+                output_double (out, resid->mean, "null");
+                output_printf (out, ", \"std\": ");
+                output_double (out, sqrt (resid_stats_variance (resid)), "null");
+                output_printf (out, ", \"max_resid\": ");
+                output_double (out, resid->max_val, "null");
+                output_printf (out, ", \"mean_depth\": ");
+                output_double (out, resid->mean_depth, "null");
+                output_printf (out, "}");
+
+                first = 0;
+            }
+        }
+
+        output_printf (out, "\n  ]");
+    }
+
+    output_printf (out, "\n}\n");
+}
+
+
+
+/*  One row per beam, with the file name on each row so that the output of many files can simply be
+    concatenated (after dropping the repeated header lines).  */
+
+static void export_csv (OUTPUT *out, BEAMSTATS_RESULT *result)
+{
+    EXPORT_BEAM             record;
+    int32_t                 i;
+
+
+    output_printf (out, "file,beam,soundings,good,bad,manual,filter,pfm,select,residuals,negative,rms,mean,std,"
+                   "mean_depth,min_resid,max_resid,min_depth,max_depth,median,p95,p99,tvu_pass\n");
+
+    for (i = 0 ; i < result->stats.beams.size ; i++)
+    {
+        if (result->stats.beams.count[i].total_depths <= 0) continue;
+
+        export_beam (result, i, &record);
+
+        csv_string (out, result->list_path);
+        output_printf (out, ",%d,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,", record.beam,
+                       (long long) record.total_depths, (long long) record.good, (long long) record.bad,
+                       (long long) record.manual, (long long) record.filter, (long long) record.pfm,
+                       (long long) record.select, (long long) record.count, (long long) record.neg_count);
+        output_double (out, record.rms, "");
+        output_printf (out, ",");
+        output_double (out, record.mean, "");
+        output_printf (out, ",");
+        output_double (out, record.std, "");
+        output_printf (out, ",");
+        output_double (out, record.mean_depth, "");
+        output_printf (out, ",");
+        output_double (out, record.min_resid, "");
+        output_printf (out, ",");
+        output_double (out, record.max_resid, "");
+        output_printf (out, ",");
+        output_double (out, record.min_depth, "");
+        output_printf (out, ",");
+        output_double (out, record.max_depth, "");
+        output_printf (out, ",");
+        output_double (out, record.median, "");
+        output_printf (out, ",");
+        output_double (out, record.p95, "");
+        output_printf (out, ",");
+        output_double (out, record.p99, "");
+        if (result->stats.tvu) output_printf (out, ",%lld\n", (long long) record.tvu_pass);
+        else output_printf (out, ",\n");
+    }
+}
+
+
+
+static void export_binary (OUTPUT *out, BEAMSTATS_RESULT *result)
+{
+    BEAM_STATS              *total = &result->stats;
+    EXPORT_HEADER           header;
+    EXPORT_BEAM             record;
+    int32_t                 i;
+
+
+    memset (&header, 0, sizeof (EXPORT_HEADER));
+
+    memcpy (header.magic, EXPORT_MAGIC, 8);
+    header.version = EXPORT_VERSION;
+    header.header_size = sizeof (EXPORT_HEADER);
+    header.beam_size = sizeof (EXPORT_BEAM);
+
+    for (i = 0 ; i < total->beams.size ; i++) header.num_beams += (total->beams.count[i].total_depths > 0);
+
+    header.width = result->width;
+    header.height = result->height;
+    header.region[0] = result->region.x0;
+    header.region[1] = result->region.y0;
+    header.region[2] = result->region.x1;
+    header.region[3] = result->region.y1;
+    header.total_filter = total->total_filter;
+    header.total_manual = total->total_manual;
+    header.total_pfm = total->total_pfm;
+    header.total_bad = total->total_bad;
+    header.total_good = total->total_good;
+    header.total_select = total->total_select;
+    header.bin_count = total->bin_count;
+    header.bin2_count = total->bin2_count;
+    header.bad_beams = total->bad_beams;
+
+    for (i = 0 ; i < COVERAGE_LEVELS ; i++)
+    {
+        header.coverage[i] = total->coverage[i];
+        header.coverage_kilos[i] = result->coverage_kilos[i];
+        header.coverage_nmiles[i] = result->coverage_nmiles[i];
+    }
+
+    if (total->sketches.size) header.flags |= EXPORT_QUANTILES;
+    if (total->tvu) header.flags |= EXPORT_TVU;
+    if (result->subset) header.flags |= EXPORT_SUBSET;
+
+    header.bin_size_xy = result->bin_size_xy;
+    header.min_x = result->mbr.min_x;
+    header.min_y = result->mbr.min_y;
+    header.max_x = result->mbr.max_x;
+    header.max_y = result->mbr.max_y;
+    header.square_kilometers = result->square_kilometers;
+    header.square_nmiles = result->square_nmiles;
+    header.tvu_a = total->tvu ? sqrt (total->tvu_a2) : NAN;
+    header.tvu_b = total->tvu ? sqrt (total->tvu_b2) : NAN;
+    snprintf (header.list_path, sizeof (header.list_path), "%s", result->list_path);
+
+    output_reserve (out, sizeof (EXPORT_HEADER) + header.num_beams * sizeof (EXPORT_BEAM));
+    output_append (out, &header, sizeof (EXPORT_HEADER));
+
+    for (i = 0 ; i < total->beams.size ; i++)
+    {
+        if (total->beams.count[i].total_depths <= 0) continue;
+
+        export_beam (result, i, &record);
+        output_append (out, &record, sizeof (EXPORT_BEAM));
+    }
+}
+
+
+
+/*  Write the report for "result" in "format".  Returns 0, or -1 if the write failed.  */
+
+int32_t beamstats_export (FILE *fp, BEAMSTATS_RESULT *result, int32_t format)
+{
+    OUTPUT                  out;
+    int32_t                 status = 0;
+
+
+    if (format == FORMAT_TEXT)
+    {
+        beamstats_report (fp, result);
+        return (ferror (fp) ? -1 : 0);
+    }
+
+    memset (&out, 0, sizeof (OUTPUT));
+
+    switch (format)
+    {
+    case FORMAT_JSON:
+        export_json (&out, result);
+        break;
+
+    case FORMAT_CSV:
+        export_csv (&out, result);
+        break;
+
+    case FORMAT_BINARY:
+        export_binary (&out, result);
+        break;
+    }
+
+    if (out.size && fwrite (out.data, 1, out.size, fp) != out.size) status = -1;
+
+    if (out.data) free (out.data);
+
+    return (status);
+}
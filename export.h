@@ -0,0 +1,135 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __EXPORT_H__
+#define __EXPORT_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "beamstats.h"
+
+
+  /*  --format values.  */
+
+#define       FORMAT_TEXT          0
+#define       FORMAT_JSON          1
+#define       FORMAT_CSV           2
+#define       FORMAT_BINARY        3
+
+
+#define       EXPORT_MAGIC         "PFMBSTAT"
+#define       EXPORT_VERSION       2
+
+
+  /*  EXPORT_HEADER flags.  */
+
+#define       EXPORT_QUANTILES     1          /*  median, p95, and p99 are filled in       */
+#define       EXPORT_TVU           2          /*  tvu_pass, tvu_a, and tvu_b are filled in */
+#define       EXPORT_SUBSET        4          /*  only "region" was processed              */
+
+
+  /*  The binary report is this header followed by num_beams EXPORT_BEAM records (only the beams with
+      soundings), in native byte order, so it can be read (or mapped) straight into these structures.
+      Values that weren't collected are NaN.  */
+
+  typedef struct
+  {
+    char          magic[8];            /*  EXPORT_MAGIC (not terminated)            */
+    uint32_t      version;             /*  EXPORT_VERSION                           */
+    uint32_t      header_size;         /*  sizeof (EXPORT_HEADER)                   */
+    uint32_t      beam_size;           /*  sizeof (EXPORT_BEAM)                     */
+    int32_t       num_beams;           /*  beam records after the header            */
+    int32_t       width;               /*  bin_width                                */
+    int32_t       height;              /*  bin_height                               */
+    int32_t       region[4];           /*  bins processed (x0, y0, x1, y1 exclusive) */
+    int32_t       flags;               /*  EXPORT_QUANTILES | EXPORT_TVU | ...      */
+    int32_t       pad;
+    int64_t       total_filter;
+    int64_t       total_manual;
+    int64_t       total_pfm;
+    int64_t       total_bad;
+    int64_t       total_good;
+    int64_t       total_select;
+    int64_t       bin_count;
+    int64_t       bin2_count;
+    int64_t       bad_beams;
+    int64_t       coverage[COVERAGE_LEVELS];   /*  bins with 100% through 400%      */
+    double        bin_size_xy;         /*  bin size in meters                       */
+    double        min_x;               /*  grid bounds                              */
+    double        min_y;
+    double        max_x;
+    double        max_y;
+    double        square_kilometers;
+    double        square_nmiles;
+    double        coverage_kilos[COVERAGE_LEVELS];
+    double        coverage_nmiles[COVERAGE_LEVELS];
+    double        tvu_a;
+    double        tvu_b;
+    char          list_path[1024];     /*  PFM handle or list file                  */
+  } EXPORT_HEADER;
+
+
+  typedef struct
+  {
+    int32_t       beam;                /*  beam number as printed (PFM beam + 1)    */
+    int32_t       pad;
+    int64_t       total_depths;
+    int64_t       bad;
+    int64_t       good;
+    int64_t       manual;
+    int64_t       filter;
+    int64_t       select;
+    int64_t       pfm;
+    int64_t       tvu_pass;            /*  residuals within the TVU                 */
+    int64_t       count;               /*  residuals                                */
+    int64_t       neg_count;           /*  negative residuals                       */
+    double        mean;                /*  mean residual                            */
+    double        std;                 /*  residual standard deviation              */
+    double        rms;
+    double        mean_depth;
+    double        min_resid;           /*  minimum absolute residual                */
+    double        max_resid;           /*  maximum absolute residual                */
+    double        min_depth;
+    double        max_depth;
+    double        median;              /*  median residual                          */
+    double        p95;                 /*  95th percentile absolute residual        */
+    double        p99;                 /*  99th percentile absolute residual        */
+  } EXPORT_BEAM;
+
+
+  int32_t parse_format (char *name);
+  char *format_extension (int32_t format);
+  int32_t beamstats_export (FILE *fp, BEAMSTATS_RESULT *result, int32_t format);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
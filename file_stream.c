@@ -0,0 +1,207 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#ifdef NVLinux
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "file_stream.h"
+
+
+/*  Free physical memory in bytes, or -1 if we can't tell.  */
+
+static int64_t free_memory ()
+{
+#ifdef NVLinux
+    long                    pages = sysconf (_SC_AVPHYS_PAGES), page_size = sysconf (_SC_PAGESIZE);
+
+    if (pages > 0 && page_size > 0) return ((int64_t) pages * page_size);
+#endif
+
+    return (-1);
+}
+
+
+static void *stream_files (void *arg)
+{
+    FILE_STREAM             *stream = (FILE_STREAM *) arg;
+    FILE                    *fp[FILE_STREAM_MAX_FILES];
+    int64_t                 size[FILE_STREAM_MAX_FILES], offset[FILE_STREAM_MAX_FILES];
+    uint8_t                 *block;
+    size_t                  got;
+    int64_t                 memory = free_memory ();
+    int32_t                 i, open_files = 0, read_any;
+
+
+    if ((block = (uint8_t *) malloc (FILE_STREAM_BLOCK)) == NULL)
+    {
+        perror ("Allocating stream buffer");
+        return (NULL);
+    }
+
+
+    for (i = 0 ; i < stream->count ; i++)
+    {
+        offset[i] = 0;
+
+        if ((fp[i] = fopen (stream->path[i], "rb")) == NULL)
+        {
+            perror (stream->path[i]);
+            continue;
+        }
+
+        setvbuf (fp[i], NULL, _IONBF, 0);
+
+        fseeko (fp[i], 0, SEEK_END);
+        size[i] = ftello (fp[i]);
+        fseeko (fp[i], 0, SEEK_SET);
+
+        if (!stream->paced[i] && (memory < 0 || size[i] > memory / 2))
+        {
+            fclose (fp[i]);
+            fp[i] = NULL;
+
+            pthread_mutex_lock (&stream->mutex);
+            stream->skipped++;
+            pthread_mutex_unlock (&stream->mutex);
+
+            continue;
+        }
+
+#ifdef NVLinux
+        posix_fadvise (fileno (fp[i]), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+        open_files++;
+    }
+
+
+    /*  Read a block from each file that isn't paced or is behind its limit, or wait for the engine to move
+        on.  */
+
+    pthread_mutex_lock (&stream->mutex);
+
+    while (open_files && !stream->stop)
+    {
+        read_any = 0;
+
+        for (i = 0 ; i < stream->count ; i++)
+        {
+            if (fp[i] == NULL ||
+                (stream->paced[i] && offset[i] >= (int64_t) (stream->fraction * size[i]) + FILE_STREAM_AHEAD))
+                continue;
+
+            pthread_mutex_unlock (&stream->mutex);
+            got = fread (block, 1, FILE_STREAM_BLOCK, fp[i]);
+            pthread_mutex_lock (&stream->mutex);
+
+            if (!got)
+            {
+                fclose (fp[i]);
+                fp[i] = NULL;
+                open_files--;
+                continue;
+            }
+
+            offset[i] += got;
+            stream->bytes += got;
+            read_any = 1;
+        }
+
+        if (!read_any && open_files && !stream->stop) pthread_cond_wait (&stream->moved, &stream->mutex);
+    }
+
+    pthread_mutex_unlock (&stream->mutex);
+
+
+    for (i = 0 ; i < stream->count ; i++) if (fp[i]) fclose (fp[i]);
+
+    free (block);
+
+    return (NULL);
+}
+
+
+
+/*  Start reading the files (stream->count, path, and paced set by the caller) in the background.  Returns
+    0 on success.  */
+
+int32_t file_stream_start (FILE_STREAM *stream)
+{
+    stream->bytes = 0;
+    stream->fraction = 0.0;
+    stream->stop = 0;
+    stream->skipped = 0;
+
+    pthread_mutex_init (&stream->mutex, NULL);
+    pthread_cond_init (&stream->moved, NULL);
+
+    if (pthread_create (&stream->thread, NULL, stream_files, stream))
+    {
+        perror ("Starting stream thread");
+        pthread_mutex_destroy (&stream->mutex);
+        pthread_cond_destroy (&stream->moved);
+        return (-1);
+    }
+
+    return (0);
+}
+
+
+
+/*  The engine has handed out "fraction" of its bands (see run_engine's BAND_CLAIMED).  */
+
+void file_stream_advance (FILE_STREAM *stream, double fraction)
+{
+    pthread_mutex_lock (&stream->mutex);
+
+    if (fraction > stream->fraction)
+    {
+        stream->fraction = fraction;
+        pthread_cond_signal (&stream->moved);
+    }
+
+    pthread_mutex_unlock (&stream->mutex);
+}
+
+
+
+/*  Stop (if it's still going) and wait for the stream thread.  */
+
+void file_stream_stop (FILE_STREAM *stream)
+{
+    pthread_mutex_lock (&stream->mutex);
+    stream->stop = 1;
+    pthread_cond_signal (&stream->moved);
+    pthread_mutex_unlock (&stream->mutex);
+
+    pthread_join (stream->thread, NULL);
+
+    pthread_mutex_destroy (&stream->mutex);
+    pthread_cond_destroy (&stream->moved);
+}
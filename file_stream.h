@@ -0,0 +1,87 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __FILE_STREAM_H__
+#define __FILE_STREAM_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdint.h>
+#include <pthread.h>
+
+
+#define       FILE_STREAM_MAX_FILES    2
+#define       FILE_STREAM_BLOCK        (16 * 1024 * 1024)
+
+
+  /*  How far (bytes) each file is read ahead of the engine's position in it.  */
+
+#define       FILE_STREAM_AHEAD        (4 * FILE_STREAM_BLOCK)
+
+
+  /*  Background sequential reader.  The PFM library decodes depth records itself (the on-disk packing
+      isn't part of its public interface) and it does that by following each bin's depth chain, which
+      means a seek per chain block.  Reading the files front to back in big blocks while the bins are
+      being processed puts the data in the operating system's page cache so those seeks become memory
+      copies instead of disk (or network) round trips.
+
+      A file in row order (the bin file, paced set) is read in step with the engine rather than as fast
+      as possible, otherwise on a file bigger than memory the pages are evicted again before they're
+      used and the I/O doubles.  The engine reports the fraction of bands it has handed out
+      (file_stream_advance) and the file is only read up to that fraction of its size plus
+      FILE_STREAM_AHEAD.
+
+      The depth file is in load order, so no position in it goes with a position in the grid and pacing
+      it would only hold back the chains the first rows need.  A file that isn't paced is read straight
+      through as fast as possible if it fits in half of the free memory, and isn't streamed at all if it
+      doesn't (or if the free memory can't be found out), since its pages would be gone before the engine
+      got to them.  */
+
+  typedef struct
+  {
+    int32_t       count;                                    /*  number of files to stream    */
+    char          path[FILE_STREAM_MAX_FILES][1024];        /*  files to stream, in order    */
+    int32_t       paced[FILE_STREAM_MAX_FILES];             /*  in row order, keep in step   */
+    int32_t       skipped;                                  /*  files too big to stream      */
+    int64_t       bytes;                                    /*  bytes read so far            */
+    double        fraction;                                 /*  engine position (0 - 1)      */
+    int32_t       stop;                                     /*  set to stop early            */
+    pthread_mutex_t mutex;                                  /*  guards bytes, fraction, stop */
+    pthread_cond_t moved;                                   /*  fraction moved or stop set   */
+    pthread_t     thread;
+  } FILE_STREAM;
+
+
+  int32_t file_stream_start (FILE_STREAM *stream);
+  void file_stream_advance (FILE_STREAM *stream, double fraction);
+  void file_stream_stop (FILE_STREAM *stream);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
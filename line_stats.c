@@ -0,0 +1,171 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "line_stats.h"
+
+
+static void alloc_entries (LINE_TABLE *table, int32_t capacity)
+{
+    if ((table->entry = (LINE_BEAM *) calloc (capacity, sizeof (LINE_BEAM))) == NULL)
+    {
+        perror ("Allocating line table");
+        exit (-1);
+    }
+
+    table->capacity = capacity;
+
+    for (table->shift = 32 ; capacity > 1 ; capacity >>= 1) table->shift--;
+}
+
+
+
+/*  "capacity" has to be a power of two.  */
+
+void line_table_init (LINE_TABLE *table, int32_t capacity)
+{
+    table->size = 0;
+    alloc_entries (table, capacity);
+}
+
+
+
+void line_table_free (LINE_TABLE *table)
+{
+    if (table->entry) free (table->entry);
+
+    memset (table, 0, sizeof (LINE_TABLE));
+}
+
+
+
+/*  Slot for "key", which isn't in the table.  */
+
+static LINE_BEAM *empty_slot (LINE_TABLE *table, uint32_t key)
+{
+    uint32_t                i;
+
+
+    for (i = line_table_slot (table, key) ; table->entry[i].used ; i = (i + 1) & (table->capacity - 1));
+
+    return (&table->entry[i]);
+}
+
+
+
+/*  Add a new (zeroed) record for "key", doubling the table first if it would be more than half full.  */
+
+LINE_BEAM *line_table_insert (LINE_TABLE *table, uint32_t key)
+{
+    LINE_BEAM               *old = table->entry, *entry;
+    int32_t                 i, old_capacity = table->capacity;
+
+
+    if ((table->size + 1) * 2 > table->capacity)
+    {
+        alloc_entries (table, old_capacity * 2);
+
+        for (i = 0 ; i < old_capacity ; i++)
+        {
+            if (old[i].used) *empty_slot (table, old[i].key) = old[i];
+        }
+
+        free (old);
+    }
+
+    entry = empty_slot (table, key);
+
+    memset (entry, 0, sizeof (LINE_BEAM));
+    entry->key = key;
+    entry->used = 1;
+    resid_stats_init (&entry->resid);
+
+    table->size++;
+
+    return (entry);
+}
+
+
+
+/*  Add the records in "part" to "total".  */
+
+void line_table_merge (LINE_TABLE *total, LINE_TABLE *part)
+{
+    LINE_BEAM               *t, *p;
+    int32_t                 i;
+
+
+    for (i = 0 ; i < part->capacity ; i++)
+    {
+        p = &part->entry[i];
+
+        if (!p->used) continue;
+
+        t = line_table_get (total, p->key >> 16, p->key & 0xffff);
+
+        t->total_depths += p->total_depths;
+        t->good += p->good;
+        t->bad += p->bad;
+
+        resid_stats_merge (&t->resid, &p->resid);
+    }
+}
+
+
+
+static int32_t compare_key (const void *a, const void *b)
+{
+    uint32_t ka = ((LINE_BEAM *) a)->key, kb = ((LINE_BEAM *) b)->key;
+
+
+    return (ka < kb ? -1 : ka > kb ? 1 : 0);
+}
+
+
+
+/*  Returns the records sorted by line and then beam (table->size of them).  The caller frees it.  */
+
+LINE_BEAM *line_table_sort (LINE_TABLE *table)
+{
+    LINE_BEAM               *sorted;
+    int32_t                 i, n = 0;
+
+
+    if ((sorted = (LINE_BEAM *) malloc ((table->size + 1) * sizeof (LINE_BEAM))) == NULL)
+    {
+        perror ("Allocating line table");
+        exit (-1);
+    }
+
+    for (i = 0 ; i < table->capacity ; i++)
+    {
+        if (table->entry[i].used) sorted[n++] = table->entry[i];
+    }
+
+    qsort (sorted, n, sizeof (LINE_BEAM), compare_key);
+
+    return (sorted);
+}
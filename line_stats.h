@@ -0,0 +1,99 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __LINE_STATS_H__
+#define __LINE_STATS_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdint.h>
+
+#include "resid_stats.h"
+
+
+  /*  Statistics for one beam of one survey line.  */
+
+  typedef struct
+  {
+    uint32_t      key;                 /*  line << 16 | beam                        */
+    uint32_t      used;                /*  slot holds a record (every key is valid) */
+    int64_t       total_depths;        /*  soundings counted                        */
+    int64_t       good;                /*  good soundings                           */
+    int64_t       bad;                 /*  manual and filter edits                  */
+    RESID_STATS   resid;               /*  repeatability statistics                 */
+  } LINE_BEAM;
+
+
+  /*  Open addressing (linear probe) hash table of LINE_BEAM records so that memory goes with the number
+      of line and beam pairs actually present rather than lines x beams.  The capacity is a power of two
+      and is kept at least twice the number of records.  */
+
+  typedef struct
+  {
+    int32_t       size;                /*  records in use                           */
+    int32_t       capacity;            /*  slots (0 = not collecting line stats)    */
+    int32_t       shift;               /*  32 - log2 (capacity)                     */
+    LINE_BEAM     *entry;
+  } LINE_TABLE;
+
+
+  void line_table_init (LINE_TABLE *table, int32_t capacity);
+  void line_table_free (LINE_TABLE *table);
+  LINE_BEAM *line_table_insert (LINE_TABLE *table, uint32_t key);
+  void line_table_merge (LINE_TABLE *total, LINE_TABLE *part);
+  LINE_BEAM *line_table_sort (LINE_TABLE *table);
+
+
+  /*  Fibonacci hashing.  The slot is the top bits of the product since the low bits only depend on the
+      low bits of the key (the beam number).  */
+
+  static inline uint32_t line_table_slot (LINE_TABLE *table, uint32_t key)
+  {
+    return ((key * 0x9e3779b1u) >> table->shift);
+  }
+
+
+  /*  Returns the record for "line" and "beam" (beam has to be 0 - 65535), adding it if it isn't there.  */
+
+  static inline LINE_BEAM *line_table_get (LINE_TABLE *table, int32_t line, int32_t beam)
+  {
+    uint32_t      key = ((uint32_t) (uint16_t) line << 16) | (uint32_t) beam, i;
+
+
+    for (i = line_table_slot (table, key) ; table->entry[i].used ; i = (i + 1) & (table->capacity - 1))
+    {
+      if (table->entry[i].key == key) return (&table->entry[i]);
+    }
+
+    return (line_table_insert (table, key));
+  }
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -40,6 +40,7 @@
 #include <errno.h>
 #include <string.h>
 #include <math.h>
+#include <getopt.h>
 
 #include "nvutility.h"
 
@@ -49,378 +50,837 @@
 
 #include "version.h"
 
+#include "beamstats.h"
+#include "report.h"
+#include "benchmark.h"
+#include "batch.h"
+#include "export.h"
+#include "state.h"
+
+static void usage ()
+{
+    fprintf (stderr, "USAGE: pfm_beamstats [--threads N] [--queue N] [--queue-mb N] [--stream] [--profile[=JSON_FILE]]\n");
+    fprintf (stderr, "\t\t[--cache[=CACHE_FILE]] [--window X0,Y0,X1,Y1 | --bbox W,S,E,N | --polygon FILE] [--tiles N]\n");
+    fprintf (stderr, "\t\t[--lines[=LINE_FILE]] [--percentiles] [--tvu ORDER | --tvu A,B] [--format FORMAT]\n");
+    fprintf (stderr, "\t\t[--save-state[=STATE_FILE]] [--sample[=P1,P2,...]] [--raster[=TIFF_FILE]] [--counts-only]\n");
+    fprintf (stderr, "\t\t[--depth-bands[=D1,D2,...]]\n");
+    fprintf (stderr, "\t\t<PFM_HANDLE_FILE or PFM_LIST_FILE> [output filespec]\n\n");
+    fprintf (stderr, "       pfm_beamstats --batch [--manifest FILE] [--report-dir DIR] [--threads N] [--queue N]\n");
+    fprintf (stderr, "\t\t[--queue-mb N] [--format FORMAT] [--save-state] [PFM_HANDLE_FILE or PFM_LIST_FILE ...]\n\n");
+    fprintf (stderr, "       pfm_beamstats --merge [--manifest FILE] [--format FORMAT] [--save-state=STATE_FILE]\n");
+    fprintf (stderr, "\t\t[STATE_FILE ...]\n\n");
+    fprintf (stderr, "       pfm_beamstats --benchmark [--bench-size WxH ...] [--bench-soundings N] [--bench-beams N]\n");
+    fprintf (stderr, "\t\t[--bench-lines N] [--bench-flags M,F,D,S,P] [--bench-repeat N] [--threads N] [--queue N]\n");
+    fprintf (stderr, "\t\t[--counts-only] [output filespec]\n\n");
+    fprintf (stderr, "       pfm_beamstats --self-check [--bench-size WxH] [--threads N] [--queue N]\n\n");
+    fprintf (stderr, "\t--threads N\tprocess row bands with N worker threads (default 1)\n");
+    fprintf (stderr, "\t--queue N\tread up to N rows ahead of each worker in a separate reader thread\n");
+    fprintf (stderr, "\t\t\t(default 0, read in the worker)\n");
+    fprintf (stderr, "\t--queue-mb N\tlimit each worker's read ahead to about N MB (default 256)\n");
+    fprintf (stderr, "\t--stream\tread the PFM files sequentially in the background so the per bin reads are\n");
+    fprintf (stderr, "\t\t\tserved from memory (useful on network storage).  The bin file is read a\n");
+    fprintf (stderr, "\t\t\tlittle ahead of the rows being processed.  The depth file isn't in row order,\n");
+    fprintf (stderr, "\t\t\tso it's read straight through if it fits in half of the free memory and\n");
+    fprintf (stderr, "\t\t\tnot streamed at all if it doesn't\n");
+    fprintf (stderr, "\t--profile\tprint phase times, throughput, bytes read, and peak memory to stderr on\n");
+    fprintf (stderr, "\t\t\texit, followed by the same numbers as JSON (written to JSON_FILE if given)\n");
+    fprintf (stderr, "\t--cache		keep the per band partial results in CACHE_FILE (default is the PFM file name\n");
+    fprintf (stderr, "\t\t\twith .bscache appended) and on later runs only reprocess the bands whose bin\n");
+    fprintf (stderr, "\t\t\trecords have changed (not used with a region, tiles, lines, percentiles, TVU,\n");
+    fprintf (stderr, "\t\t\t--sample, --raster, --depth-bands, or --counts-only)\n");
+    fprintf (stderr, "\t--window X0,Y0,X1,Y1\tonly process bin columns X0 - X1 and rows Y0 - Y1\n");
+    fprintf (stderr, "\t--bbox W,S,E,N\tonly process the bins that overlap a lon/lat rectangle\n");
+    fprintf (stderr, "\t--polygon FILE\tonly process the bins whose centers are inside a polygon (one\n");
+    fprintf (stderr, "\t\t\t\"longitude latitude\" vertex per line)\n");
+    fprintf (stderr, "\t--tiles N\tadd a table of totals for each N x N bin tile to the report\n");
+    fprintf (stderr, "\t--lines\t\tadd the repeatability table for each survey line and beam to the report\n");
+    fprintf (stderr, "\t\t\t(or write it to LINE_FILE)\n");
+    fprintf (stderr, "\t--percentiles\tadd the median and 95th and 99th percentile absolute residual for each\n");
+    fprintf (stderr, "\t\t\tbeam to the report (estimated to within 1%%)\n");
+    fprintf (stderr, "\t--tvu ORDER\tadd the percentage of each beam's residuals within the IHO S-44 total\n");
+    fprintf (stderr, "\t\t\tvertical uncertainty for ORDER (exclusive, special, 1a, 1b, or 2), or for\n");
+    fprintf (stderr, "\t\t\tsqrt (A^2 + (B * depth)^2) if A,B is given\n");
+    fprintf (stderr, "\t--format FORMAT\twrite the report as text (default), json, csv (one row per beam), or\n");
+    fprintf (stderr, "\t\t\tbinary (the EXPORT_HEADER and EXPORT_BEAM records in export.h), with full\n");
+    fprintf (stderr, "\t\t\tprecision values\n");
+    fprintf (stderr, "\t--save-state\talso write the per beam accumulators to STATE_FILE (default is the PFM file\n");
+    fprintf (stderr, "\t\t\tname with .bsstate appended, or next to each report with --batch)\n");
+    fprintf (stderr, "\t--sample\tread the row bands in an evenly spread order and print per beam estimates\n");
+    fprintf (stderr, "\t\t\twith 95%% confidence intervals to stderr after P1, P2, ... percent of them (default\n");
+    fprintf (stderr, "\t\t\t1,5,25), then finish the full report as usual (stop it at any time for a\n");
+    fprintf (stderr, "\t\t\tquick look)\n");
+    fprintf (stderr, "\t--raster\talso write a GeoTIFF of the RMS residual, maximum absolute residual, edited\n");
+    fprintf (stderr, "\t\t\tfraction, and number of distinct lines (up to 4) of each bin to TIFF_FILE\n");
+    fprintf (stderr, "\t\t\t(default is the PFM file name with .beamstats.tif appended, not used with\n");
+    fprintf (stderr, "\t\t\t--sample)\n");
+    fprintf (stderr, "\t--counts-only\tonly count the edits and coverage, without the per beam repeatability\n");
+    fprintf (stderr, "\t\t\ttable (not used with --percentiles, --tvu, or --depth-bands)\n");
+    fprintf (stderr, "\t--depth-bands\tadd the repeatability table for each depth band (shallower than D1, D1 - D2,\n");
+    fprintf (stderr, "\t\t\t..., and deeper than the last, in meters) to the report (default 40,100, up to %d\n",
+             DEPTH_MAX_EDGES);
+    fprintf (stderr, "\t\t\tdepths)\n\n");
+    fprintf (stderr, "\t--batch		process every PFM named on the command line (and in the manifest) with one\n");
+    fprintf (stderr, "\t\t\tpool of threads, write a report for each one, and write a summary of all of\n");
+    fprintf (stderr, "\t\t\tthem to stdout\n");
+    fprintf (stderr, "\t--manifest FILE	read PFM file names from FILE, one per line (implies --batch)\n");
+    fprintf (stderr, "\t--report-dir DIR	write the batch reports to DIR (default is next to each PFM as\n");
+    fprintf (stderr, "\t\t\tPFM_FILE.beamstats.txt)\n\n");
+    fprintf (stderr, "\t--merge\t\tcombine the state files named on the command line (and in the manifest)\n");
+    fprintf (stderr, "\t\t\tinto one report on stdout without reading any PFM data (the PFM files are\n");
+    fprintf (stderr, "\t\t\tassumed not to overlap when the coverage areas are added up)\n\n");
+    fprintf (stderr, "\t--benchmark\ttime the statistics engine on synthetic in memory data instead of a PFM\n");
+    fprintf (stderr, "\t\t\tfile and report soundings/s for each grid size\n");
+    fprintf (stderr, "\t--bench-size WxH\tgrid size (may be repeated, default 256x256, 1024x1024, 2048x2048)\n");
+    fprintf (stderr, "\t--bench-soundings N\tmean soundings per populated bin (default 8)\n");
+    fprintf (stderr, "\t--bench-beams N\tnumber of beams (default 256)\n");
+    fprintf (stderr, "\t--bench-lines N\tnumber of survey lines (default 4)\n");
+    fprintf (stderr, "\t--bench-flags M,F,D,S,P\tpercent manually invalid, filter invalid, deleted, selected,\n");
+    fprintf (stderr, "\t\t\tand PFM_MODIFIED soundings (default 5,5,1,2,10)\n");
+    fprintf (stderr, "\t--bench-repeat N\treport the fastest of N runs of each size (default 1)\n\n");
+    fprintf (stderr, "\t--self-check\tcheck that a synthetic grid (default 500x300) gives exactly the same\n");
+    fprintf (stderr, "\t\t\tstatistics with 1 and N threads (4 if N is 1) and through a band cache (a\n");
+    fprintf (stderr, "\t\t\tscratch %s is written and removed in the current directory)\n\n",
+             CHECK_CACHE_PATH);
+    exit (-1);
+}
+
+
+
+/*  Fill in one of the output file names ("format" with "name" in it) or give up if it won't fit in the
+    "size" byte buffer.  */
+
+static void set_path (char *path, size_t size, char *format, char *name)
+{
+    if (snprintf (path, size, format, name) >= (int) size)
+    {
+        fprintf (stderr, "%s: file name too long\n\n", name);
+        exit (-1);
+    }
+}
+
 
-#define  MAX_BEAMS  1024
 
+/*  --sample percentages ("1,5,25"), which have to increase.  Returns the number of them or -1.  */
+
+static int32_t parse_sample_steps (char *list, double *steps)
+{
+    char                    *token;
+    int32_t                 count = 0;
+
+
+    for (token = strtok (list, ",") ; token ; token = strtok (NULL, ","))
+    {
+        if (count == SAMPLE_MAX_STEPS || sscanf (token, "%lf", &steps[count]) != 1 || steps[count] <= 0.0 ||
+            steps[count] > 100.0 || (count && steps[count] <= steps[count - 1])) return (-1);
+
+        steps[count++] /= 100.0;
+    }
+
+    return (count ? count : -1);
+}
+
+
+
+/*  --depth-bands boundaries ("40,100"), which have to increase.  Returns the number of them or -1.  */
+
+static int32_t parse_depth_edges (char *list, float *edges)
+{
+    char                    *token;
+    int32_t                 count = 0;
+
+
+    for (token = strtok (list, ",") ; token ; token = strtok (NULL, ","))
+    {
+        if (count == DEPTH_MAX_EDGES || sscanf (token, "%f", &edges[count]) != 1 ||
+            (count && edges[count] <= edges[count - 1])) return (-1);
+
+        count++;
+    }
+
+    return (count ? count : -1);
+}
+
+
+
+/*  Prints a --sample estimate (on stderr, so the report itself is the same as without --sample).  */
+
+static void print_sample (SAMPLE_ESTIMATE *estimate, void *data)
+{
+    sample_report ((FILE *) data, estimate);
+}
 
-typedef struct
-{ 
-    int32_t bad[MAX_BEAMS];          /* number of edits per beam            */
-    int32_t good[MAX_BEAMS];         /* number of good data points per beam */
-    int32_t manual[MAX_BEAMS];       /* number of manual edits              */
-    int32_t filter[MAX_BEAMS];       /* number of filter edits              */
-    int32_t select[MAX_BEAMS];       /* number of selected soundings        */
-    int32_t pfm[MAX_BEAMS];          /* number of manual edits              */
-    int32_t total_depths[MAX_BEAMS]; /* total number of depths per beam     */
-} BeamCount;
 
 
 int32_t main (int32_t argc, char **argv)
 {
-    BeamCount  beam_count;       /* beam count record for statistical counts */
-    int32_t    i, j,             /* general-purpose counters                 */
-               percent = 0,      /* percent processed counter                */
-               old_percent = -1, /* previous percent processed               */
-               grand_total,      /* total number of depths for all beams     */
-               total_filter = 0, /* total filter edited                      */
-               total_manual = 0, /* total manual edited                      */
-               total_pfm = 0,    /* total PFM bit set                        */
-               total_bad = 0,    /* total number of edits for all beams      */
-               total_good = 0,   /* total number of good depths for all beams*/
-               total_select = 0; /* total number of selected soundings       */
-    float bad_percent,      /* % of total depths that have been edited  */
-               good_percent,     /* % of total depths that are good          */
-               total_bad_percent = 0,
-                                 /* % of total depths that have been edited  */
-      total_good_percent = 0;
-                                 /* % of total depths that are good         */
-
-    PFM_OPEN_ARGS           open_args;
-    NV_I32_COORD2           coord, prev_coord = {-1, -1};
-    BIN_RECORD              bin_record;
-    DEPTH_RECORD            *depth;
-    int32_t                 pfm_handle, total_bins, recnum, bin_count, 
-                            bin2_count;
-    uint8_t                 bin_data;
-
-    int32_t                 k, m, neg_count[MAX_BEAMS], pos_count[MAX_BEAMS],
-                            min_beams = MAX_BEAMS + 1, max_beams = -1;
-    float                   rms[MAX_BEAMS], max_val[MAX_BEAMS], 
-                            min_val[MAX_BEAMS], neg_percent[MAX_BEAMS], 
-                            pos_percent[MAX_BEAMS], depthtot[MAX_BEAMS], 
-                            min_depth[MAX_BEAMS], max_depth[MAX_BEAMS], diff, 
-                            dep, square_kilometers, square_nmiles, s2_kilos,
-                            s2_nmiles, start_line_no;
-    double                  sum[MAX_BEAMS], sum2[MAX_BEAMS],
-                            meandiff[MAX_BEAMS], meandepth[MAX_BEAMS],
-                            ss[MAX_BEAMS], var[MAX_BEAMS], stddev[MAX_BEAMS], 
-                            sddepth[MAX_BEAMS];
+    int32_t    num_threads = 1,  /* number of worker threads                 */
+               stream_files = 0, /* stream the PFM files in the background   */
+               queue_depth = 0,  /* rows of read ahead per worker            */
+               queue_mb = 256,   /* read ahead memory per worker (MB)        */
+               profiling = 0,    /* --profile                                */
+               benchmark = 0,    /* --benchmark                              */
+               num_sizes = 0,    /* number of --bench-size grids             */
+               repeat = 1,       /* --bench-repeat                           */
+               cache = 0,        /* --cache                                  */
+               batch = 0,        /* --batch                                  */
+               num_files = 0,    /* number of batch files                    */
+               roi = 0,          /* 1 = window, 2 = bbox, 3 = polygon        */
+               tile_size = 0,    /* --tiles                                  */
+               line_stats = 0,   /* --lines                                  */
+               quantiles = 0,    /* --percentiles                            */
+               tvu = 0,          /* --tvu                                    */
+               format = 0,       /* --format (FORMAT_TEXT, ... export.h)     */
+               save_state = 0,   /* --save-state                             */
+               merge = 0,        /* --merge                                  */
+               sample = 0,       /* --sample                                 */
+               num_steps = 3,    /* --sample percentages                     */
+               raster = 0,       /* --raster                                 */
+               counts_only = 0,  /* --counts-only                            */
+               num_edges = 2,    /* --depth-bands boundaries (0 = none)      */
+               depth_bands = 0,  /* --depth-bands                            */
+               self_check = 0,   /* --self-check                             */
+               num_points,       /* polygon vertices                         */
+               option_index = 0;
+
+    BEAMSTATS_OPTIONS       bs_options;
+    BEAMSTATS               *bs;
+    BEAMSTATS_RESULT        *result;
+    ENGINE_OPTIONS          options;
+    int64_t                 start_ns, wall_start_ns;
+    FILE                    *json_fp = NULL;
+    SYNTH_PARAMS            synth_params;
+    NV_I32_COORD2           sizes[MAX_BENCH_SIZES];
     FILE                    *fp;
+    char                    cache_path[1100], *manifest = NULL, *report_dir = NULL, **paths, line[1024];
+    BATCH_OPTIONS           batch_options;
+    REGION                  region;
+    NV_I32_COORD2           window[2];
+    NV_F64_XYMBR            bbox;
+    NV_F64_COORD2           *points;
+    char                    *polygon_file = NULL, *line_file = NULL, state_path[1100], raster_path[1100];
+    FILE                    *line_fp;
+    int32_t                 c, status;
+    double                  tvu_a = 0.0, tvu_b = 0.0, steps[SAMPLE_MAX_STEPS] = {0.01, 0.05, 0.25};
+    float                   edges[DEPTH_MAX_EDGES] = {40.0, 100.0};
+
+    static struct option long_options[] = {{"threads", required_argument, 0, 't'},
+                                           {"stream", no_argument, 0, 's'},
+                                           {"queue", required_argument, 0, 'q'},
+                                           {"queue-mb", required_argument, 0, 'm'},
+                                           {"profile", optional_argument, 0, 'p'},
+                                           {"cache", optional_argument, 0, 'c'},
+                                           {"batch", no_argument, 0, 'b'},
+                                           {"manifest", required_argument, 0, 'M'},
+                                           {"report-dir", required_argument, 0, 'R'},
+                                           {"window", required_argument, 0, 'w'},
+                                           {"bbox", required_argument, 0, 'x'},
+                                           {"polygon", required_argument, 0, 'P'},
+                                           {"tiles", required_argument, 0, 'T'},
+                                           {"lines", optional_argument, 0, 'L'},
+                                           {"percentiles", no_argument, 0, 'Q'},
+                                           {"tvu", required_argument, 0, 'V'},
+                                           {"format", required_argument, 0, 'F'},
+                                           {"save-state", optional_argument, 0, 'S'},
+                                           {"merge", no_argument, 0, 'g'},
+                                           {"sample", optional_argument, 0, 'E'},
+                                           {"raster", optional_argument, 0, 'G'},
+                                           {"counts-only", no_argument, 0, 'C'},
+                                           {"depth-bands", optional_argument, 0, 'D'},
+                                           {"benchmark", no_argument, 0, 256},
+                                           {"bench-size", required_argument, 0, 257},
+                                           {"bench-soundings", required_argument, 0, 258},
+                                           {"bench-beams", required_argument, 0, 259},
+                                           {"bench-lines", required_argument, 0, 260},
+                                           {"bench-flags", required_argument, 0, 261},
+                                           {"bench-repeat", required_argument, 0, 262},
+                                           {"self-check", no_argument, 0, 263},
+                                           {0, no_argument, 0, 0}};
 
 
     fprintf (stderr, "\n\n %s \n\n", VERSION);
     fflush (stderr);
 
 
-    if (argc < 2)
+    synth_default_params (&synth_params);
+
+    while ((c = getopt_long (argc, argv, "t:sq:m:p::c::bM:R:w:x:P:T:L::QV:F:S::gE::G::CD::", long_options,
+                             &option_index)) != -1)
     {
-        fprintf(stderr, "USAGE: pfm_beamstats <PFM_HANDLE_FILE or PFM_LIST_FILE> [output filespec]\n");
-        exit (-1);
+        switch (c)
+        {
+        case 't':
+            if (sscanf (optarg, "%d", &num_threads) != 1 || num_threads < 1) usage ();
+            if (num_threads > MAX_THREADS) num_threads = MAX_THREADS;
+            break;
+
+        case 's':
+            stream_files = 1;
+            break;
+
+        case 'q':
+            if (sscanf (optarg, "%d", &queue_depth) != 1 || queue_depth < 0) usage ();
+            break;
+
+        case 'm':
+            if (sscanf (optarg, "%d", &queue_mb) != 1 || queue_mb < 1) usage ();
+            break;
+
+        case 'p':
+            profiling = 1;
+
+            if (optarg)
+            {
+                if ((json_fp = fopen (optarg, "w")) == NULL)
+                {
+                    perror (optarg);
+                    exit (-1);
+                }
+            }
+            else
+            {
+                json_fp = stderr;
+            }
+            break;
+
+        case 'c':
+            cache = 1;
+            if (optarg) set_path (cache_path, sizeof (cache_path), "%s", optarg);
+            else cache_path[0] = 0;
+            break;
+
+        case 'b':
+            batch = 1;
+            break;
+
+        case 'M':
+            batch = 1;
+            manifest = optarg;
+            break;
+
+        case 'R':
+            report_dir = optarg;
+            break;
+
+        case 'w':
+            if (roi || sscanf (optarg, "%d,%d,%d,%d", &window[0].x, &window[0].y, &window[1].x, &window[1].y) != 4)
+                usage ();
+            roi = 1;
+            break;
+
+        case 'x':
+            if (roi || sscanf (optarg, "%lf,%lf,%lf,%lf", &bbox.min_x, &bbox.min_y, &bbox.max_x, &bbox.max_y) != 4)
+                usage ();
+            roi = 2;
+            break;
+
+        case 'P':
+            if (roi) usage ();
+            polygon_file = optarg;
+            roi = 3;
+            break;
+
+        case 'T':
+            if (sscanf (optarg, "%d", &tile_size) != 1 || tile_size < 1) usage ();
+            break;
+
+        case 'L':
+            line_stats = 1;
+            line_file = optarg;
+            break;
+
+        case 'Q':
+            quantiles = 1;
+            break;
+
+        case 'V':
+
+            /*  IHO S-44 (6th edition) order a and b values.  */
+
+            if (!strcmp (optarg, "exclusive"))
+            {
+                tvu_a = 0.15;
+                tvu_b = 0.0075;
+            }
+            else if (!strcmp (optarg, "special"))
+            {
+                tvu_a = 0.25;
+                tvu_b = 0.0075;
+            }
+            else if (!strcmp (optarg, "1a") || !strcmp (optarg, "1b"))
+            {
+                tvu_a = 0.5;
+                tvu_b = 0.013;
+            }
+            else if (!strcmp (optarg, "2"))
+            {
+                tvu_a = 1.0;
+                tvu_b = 0.023;
+            }
+            else if (sscanf (optarg, "%lf,%lf", &tvu_a, &tvu_b) != 2 || tvu_a < 0.0 || tvu_b < 0.0)
+            {
+                usage ();
+            }
+            tvu = 1;
+            break;
+
+        case 'F':
+            if ((format = parse_format (optarg)) < 0) usage ();
+            break;
+
+        case 'S':
+            save_state = 1;
+            if (optarg) set_path (state_path, sizeof (state_path), "%s", optarg);
+            else state_path[0] = 0;
+            break;
+
+        case 'g':
+            merge = 1;
+            break;
+
+        case 'E':
+            sample = 1;
+            if (optarg && (num_steps = parse_sample_steps (optarg, steps)) < 0) usage ();
+            break;
+
+        case 'G':
+            raster = 1;
+            if (optarg) set_path (raster_path, sizeof (raster_path), "%s", optarg);
+            else raster_path[0] = 0;
+            break;
+
+        case 'C':
+            counts_only = 1;
+            break;
+
+        case 'D':
+            depth_bands = 1;
+            if (optarg && (num_edges = parse_depth_edges (optarg, edges)) < 0) usage ();
+            break;
+
+        case 256:
+            benchmark = 1;
+            break;
+
+        case 257:
+            if (num_sizes == MAX_BENCH_SIZES ||
+                sscanf (optarg, "%dx%d", &sizes[num_sizes].x, &sizes[num_sizes].y) != 2 ||
+                sizes[num_sizes].x < 1 || sizes[num_sizes].y < 1) usage ();
+            num_sizes++;
+            break;
+
+        case 258:
+            if (sscanf (optarg, "%d", &synth_params.soundings_per_bin) != 1 || synth_params.soundings_per_bin < 1)
+                usage ();
+            break;
+
+        case 259:
+            if (sscanf (optarg, "%d", &synth_params.beams) != 1 || synth_params.beams < 1) usage ();
+            break;
+
+        case 260:
+            if (sscanf (optarg, "%d", &synth_params.lines) != 1 || synth_params.lines < 1) usage ();
+            break;
+
+        case 261:
+            if (sscanf (optarg, "%f,%f,%f,%f,%f", &synth_params.manual_pct, &synth_params.filter_pct,
+                        &synth_params.deleted_pct, &synth_params.selected_pct, &synth_params.modified_pct) != 5)
+                usage ();
+            break;
+
+        case 262:
+            if (sscanf (optarg, "%d", &repeat) != 1 || repeat < 1) usage ();
+            break;
+
+        case 263:
+            self_check = 1;
+            break;
+
+        default:
+            usage ();
+            break;
+        }
     }
 
-    strcpy (open_args.list_path, argv[1]);
 
+    /*  Benchmark mode doesn't need a PFM file.  */
 
-    if (argc == 3)
+    if (benchmark)
     {
-        if ((fp = fopen (argv[2], "w")) == NULL)
+        fp = stdout;
+
+        if (argc - optind >= 1 && (fp = fopen (argv[optind], "w")) == NULL)
         {
-            perror (argv[2]);
+            perror (argv[optind]);
             exit (-1);
         }
+
+        options.threads = num_threads;
+        options.queue_depth = queue_depth;
+        options.queue_bytes = (int64_t) queue_mb * 1024 * 1024;
+        options.counts_only = counts_only;
+
+        run_benchmark (fp, &synth_params, num_sizes, sizes, repeat, &options);
+
+        if (fp != stdout) fclose (fp);
+
+        return (0);
     }
-    else
+
+
+    /*  Neither do the self checks.  */
+
+    if (self_check)
     {
-        fp = stdout;
+        options.threads = num_threads;
+        options.queue_depth = queue_depth;
+        options.queue_bytes = (int64_t) queue_mb * 1024 * 1024;
+
+        return (run_self_check (stdout, &synth_params, num_sizes, sizes, &options, CHECK_CACHE_PATH) ? -1 : 0);
     }
-   
 
-    /* zero out beam count record */
 
-    memset(&beam_count, 0, sizeof(beam_count));
+    /*  Batch and merge modes.  Every remaining argument (and every line of the manifest) is a PFM file (or a
+        state file for --merge).  */
 
+    if (batch || merge)
+    {
+        /*  Every PFM in a batch is run with just the options in BATCH_OPTIONS, so don't let the others be
+            silently ignored.  */
+
+        if (stream_files || profiling || cache || roi || tile_size || line_stats || quantiles || tvu ||
+            counts_only || depth_bands || sample || raster)
+        {
+            fprintf (stderr, "--batch and --merge only take --manifest, --report-dir, --threads, --queue,\n");
+            fprintf (stderr, "--queue-mb, --format, and --save-state\n\n");
+            usage ();
+        }
+
+        if ((paths = (char **) malloc ((argc - optind + 1) * sizeof (char *))) == NULL)
+        {
+            perror ("Allocating file list");
+            exit (-1);
+        }
+
+        for (num_files = 0 ; num_files < argc - optind ; num_files++) paths[num_files] = argv[optind + num_files];
+
+        if (manifest)
+        {
+            if ((fp = fopen (manifest, "r")) == NULL)
+            {
+                perror (manifest);
+                exit (-1);
+            }
 
-    for (i = 0 ; i < MAX_BEAMS ; i++)
+            while (fgets (line, sizeof (line), fp) != NULL)
+            {
+                line[strcspn (line, "\r\n")] = 0;
+                if (!line[0] || line[0] == '#') continue;
+
+                if ((paths = (char **) realloc (paths, (num_files + 1) * sizeof (char *))) == NULL ||
+                    (paths[num_files] = strdup (line)) == NULL)
+                {
+                    perror ("Allocating file list");
+                    exit (-1);
+                }
+
+                num_files++;
+            }
+
+            fclose (fp);
+        }
+
+        if (!num_files) usage ();
+
+
+        if (merge)
+        {
+            if (save_state && !state_path[0]) usage ();
+
+            if ((result = beamstats_merge_states (num_files, paths, &status)) == NULL)
+            {
+                if (status < 0) perror ("Merging state files");
+                else fprintf (stderr, "%s: not a readable pfm_beamstats state file\n", paths[status]);
+                exit (-1);
+            }
+
+            if (beamstats_export (stdout, result, format))
+            {
+                perror ("Writing report");
+                exit (-1);
+            }
+
+            if (save_state && beamstats_save_state (state_path, result))
+            {
+                perror (state_path);
+                exit (-1);
+            }
+
+            fprintf (stderr, "%d state files (%d PFM results) merged\n\n", num_files, result->runs);
+
+            if (result->stats.read_errors)
+                fprintf (stderr, "%lld bins couldn't be read and were left out of the statistics\n\n",
+                         (long long) result->stats.read_errors);
+
+            status = result->stats.read_errors ? -1 : 0;
+
+            beamstats_free_result (result);
+            free (paths);
+
+            return (status);
+        }
+
+
+        batch_options.threads = num_threads;
+        batch_options.queue_depth = queue_depth;
+        batch_options.queue_mb = queue_mb;
+        batch_options.progress = NVTrue;
+        batch_options.report_dir = report_dir;
+        batch_options.format = format;
+        batch_options.save_state = save_state;
+
+        return (run_batch (num_files, paths, &batch_options, stdout) ? -1 : 0);
+    }
+
+
+    if (argc - optind < 1 || (sample && raster) || (counts_only && (quantiles || tvu || depth_bands))) usage ();
+
+
+    if (argc - optind >= 2)
     {
-        neg_count[i] = 0;
-        pos_count[i] = 0;
-        min_val[i] = 99999.0;
-        max_val[i] = -99999.0;
-        min_depth[i] = 99999.0;
-        max_depth[i] = -99999.0;
-        sum[i] = 0.0;
-        sum2[i] = 0.0;
-        depthtot[i] = 0.0;
+        if ((fp = fopen (argv[optind + 1], "w")) == NULL)
+        {
+            perror (argv[optind + 1]);
+            exit (-1);
+        }
+    }
+    else
+    {
+        fp = stdout;
     }
 
 
     /* Process the input file on the command line. */
 
-    open_args.checkpoint = 0;
-    if ((pfm_handle = open_existing_pfm_file (&open_args)) < 0) 
-        pfm_error_exit (pfm_error);
+    beamstats_default_options (&bs_options);
+    bs_options.threads = num_threads;
+    bs_options.queue_depth = queue_depth;
+    bs_options.queue_mb = queue_mb;
+    bs_options.stream = stream_files;
+    bs_options.progress = NVTrue;
+    bs_options.profiling = profiling;
+    bs_options.tile_size = tile_size;
+    bs_options.line_stats = line_stats;
+    bs_options.counts_only = counts_only;
+    bs_options.quantiles = quantiles;
+    bs_options.tvu = tvu;
+    bs_options.tvu_a = tvu_a;
+    bs_options.tvu_b = tvu_b;
+
+    if (depth_bands)
+    {
+        bs_options.num_depth_edges = num_edges;
+        bs_options.depth_edges = edges;
+    }
 
+    if (cache)
+    {
+        if (!cache_path[0]) set_path (cache_path, sizeof (cache_path), "%s.bscache", argv[optind]);
+        bs_options.cache_path = cache_path;
+    }
 
-    percent = 0;
-    bin_count = 0;
-    bin2_count = 0;
+    if (raster)
+    {
+        if (!raster_path[0]) set_path (raster_path, sizeof (raster_path), "%s.beamstats.tif", argv[optind]);
+        bs_options.raster_path = raster_path;
+    }
 
-    fprintf(stderr,"\n\n");
-    fflush (stderr);
+    wall_start_ns = profile_clock ();
 
+    errno = 0;
 
-    total_bins = open_args.head.bin_height * open_args.head.bin_width;
+    if ((bs = beamstats_open (argv[optind], &bs_options)) == NULL)
+    {
+        if (errno == ENOMEM || errno == ENAMETOOLONG)
+        {
+            perror (argv[optind]);
+            exit (-1);
+        }
+
+        pfm_error_exit (pfm_error);
+    }
 
 
-    /* Process all records in the PFM index file */
+    /*  The lat/lon regions need the PFM header.  */
 
-    for (i = 0 ; i < open_args.head.bin_height ; i++)
+    if (roi)
     {
-        coord.y = i;
-        
-        for (j = 0 ; j < open_args.head.bin_width ; j++)
+        switch (roi)
         {
-            coord.x = j;
+        case 1:
+            status = region_window (&region, bs->open_args.head.bin_width, bs->open_args.head.bin_height,
+                                    window[0].x, window[0].y, window[1].x + 1, window[1].y + 1);
+            break;
 
-            bin_data = NVFalse;
+        case 2:
+            status = region_bbox (&region, &bs->open_args, &bbox);
+            break;
 
-            if (!read_depth_array_index (pfm_handle, coord, &depth, &recnum))
+        default:
+            if ((num_points = read_polygon_file (polygon_file, &points)) < 0)
             {
-                start_line_no = -1;
-                for (m = 0 ; m < recnum ; m++)
-                {
-                    k = depth[m].beam_number;
-                    dep = depth[m].xyz.z;
-
-                    if (!(depth[m].validity & PFM_DELETED))
-                    {
-                        beam_count.total_depths[k]++;
-
-                        if (depth[m].validity & PFM_MODIFIED)
-                        {
-                            beam_count.pfm[k]++;                 /* PFM bit */
-                            total_pfm++;
-                        }
-
-                        if (depth[m].validity & PFM_MANUALLY_INVAL)
-                        {
-                            beam_count.manual[k]++;              /* Manual */
-                            total_manual++;
-                            beam_count.bad[k]++;                 /* edited */
-                            total_bad++;
-                        }
-                        else if (depth[m].validity & PFM_FILTER_INVAL || 
-                            depth[m].xyz.z >= open_args.head.null_depth)
-                        {
-                            beam_count.filter[k]++;              /* Filter */
-                            total_filter++;
-                            beam_count.bad[k]++;                 /* edited */
-                            total_bad++;
-                        }
-                        else
-                        {
-                            /*  Looking for 200% or better coverage.  */
-
-                            if (start_line_no == -1) 
-                              {
-                                start_line_no = depth[m].line_number;
-                              }
-                            else
-                              {
-                                if (start_line_no != -2)
-                                  {
-                                    if (depth[m].line_number != start_line_no) 
-                                      {
-                                        bin2_count++;
-                                        start_line_no = -2;
-                                      }
-                                  }
-                              }
-
-
-                            beam_count.good[k]++;                /* good */
-                            total_good++;
-
-                            bin_data = NVTrue;
-
-
-                            if (depth[m].validity & PFM_SELECTED_SOUNDING) 
-                            {
-                                beam_count.select[k]++;          /* Selected */
-                                total_select++;
-                            }
-
-
-                            /*  Compute repeatability statistics.  */
-
-                            if (prev_coord.x != coord.x || 
-                                prev_coord.y != coord.y)
-                            {
-                                read_bin_record_index (pfm_handle, coord, 
-                                    &bin_record);
-                                prev_coord = coord;
-                            }
-
-                            if (bin_record.validity & PFM_DATA)
-                            {
-                                diff = bin_record.avg_filtered_depth - dep;
-
-                                if (dep < min_depth[k]) min_depth[k] = dep;
-
-                                if (dep > max_depth[k]) max_depth[k] = dep;
-
-                                depthtot[k] += dep;
-                                sum[k] += diff;
-                                sum2[k] += diff * diff;
-
-                                if (diff < 0.0)
-                                {
-                                    neg_count[k]++;
-                                }
-                                else
-                                {
-                                    pos_count[k]++;
-                                }
-
-                                if (fabs((double) diff) < min_val[k])
-                                    min_val[k] = fabs((double) diff);
-
-                                if (fabs((double) diff) > max_val[k])
-                                  max_val[k] = fabs((double) diff);
-
-                                if (k > max_beams) max_beams = k;
-                                if (k < min_beams) min_beams = k;
-                            }
-                        }
-                    }
-                }
-                free (depth);
-
-                if (bin_data) bin_count++;
+                perror (polygon_file);
+                exit (-1);
             }
+
+            status = region_polygon (&region, &bs->open_args, points, num_points);
+            free (points);
+            break;
         }
 
-        percent = ((float) (i * open_args.head.bin_width + j) / 
-            (float) total_bins) * 100.0;
-        if (old_percent != percent)
+        if (status)
         {
-            fprintf (stderr, "%03d%% processed     \r", percent);
-            old_percent = percent;
-            fflush (stderr);
+            fprintf (stderr, "The requested area doesn't contain any bins of %s\n\n", argv[optind]);
+            exit (-1);
         }
+
+        bs->options.region = &region;
     }
 
-    percent = 100;
 
-    fprintf(stderr,"%03d%% processed        \n\n", percent);
+    fprintf(stderr,"\n\n");
     fflush (stderr);
 
 
+    /* Process all records in the PFM index file */
 
-    /* calculate totals */
+    if (sample)
+    {
+        beamstats_sample (bs, num_steps, steps, print_sample, stderr);
+        fprintf (stderr, "\n\n");
+    }
+    else
+    {
+        beamstats_accumulate (bs);
+    }
 
-    grand_total = total_bad + total_good;
-    square_kilometers = (bin_count * (open_args.head.bin_size_xy * 
-        open_args.head.bin_size_xy)) / (1000.0 * 1000.0);
-    square_nmiles = square_kilometers / (1.852 * 1.852);
-    s2_kilos = (bin2_count * (open_args.head.bin_size_xy * 
-        open_args.head.bin_size_xy)) / (1000.0 * 1000.0);
-    s2_nmiles = s2_kilos / (1.852 * 1.852);
+    if ((result = beamstats_finalize (bs)) == NULL)
+    {
+        fprintf (stderr, "\nUnable to compute the beam statistics (out of memory, or a thread couldn't be\n");
+        fprintf (stderr, "started)\n\n");
+        exit (-1);
+    }
 
 
-    /* print results */
+    fprintf(stderr,"%03d%% processed        \n\n", 100);
+    fflush (stderr);
 
-    fprintf(fp, "#\n#Filename:  %s\n", open_args.list_path);
-    fprintf(fp, "#\n#Square kilometers covered:  %f\n", square_kilometers);
-    fprintf(fp, "#\n#Square nautical miles covered:  %f\n", square_nmiles);
-    fprintf(fp, "#\n#Square kilometers covered at 200%% or better:  %f  (%.1f%%)\n", 
-            s2_kilos, s2_kilos / square_kilometers * 100.0);
-    fprintf(fp, "#\n#Square nautical miles covered at 200%% or better:  %f  (%.1f%%)\n", 
-            s2_nmiles, s2_nmiles / square_nmiles * 100.0);
-   
-    fprintf(fp, "#\n#\n");
-    fprintf(fp, "#Beam Stats\n");
-    fprintf(fp, "#---------------------------\n\n");
+
+    if (cache && (roi || tile_size || line_stats || quantiles || tvu || sample || raster || depth_bands || counts_only))
+    {
+        fprintf (stderr, "The band cache isn't used with --window, --bbox, --polygon, --tiles, --lines,\n");
+        fprintf (stderr, "--percentiles, --tvu, --sample, --raster, --depth-bands, or --counts-only\n\n");
+        fflush (stderr);
+    }
+    else if (cache)
+    {
+        fprintf (stderr, "%d of %d bands merged from %s\n", result->cached_bands, result->num_bands, cache_path);
+        if (result->stats.read_errors)
+            fprintf (stderr, "Band cache %s not updated (some bins couldn't be read)\n", cache_path);
+        else if (!result->cache_saved) fprintf (stderr, "Unable to write band cache %s\n", cache_path);
+        fprintf (stderr, "\n");
+        fflush (stderr);
+    }
 
 
-    fprintf(fp, "#\t\t  %%BAD   %%GOOD    #BAD       #GOOD     #MANUAL    #FILTER      #PFM      #SELECTED\n");
-    fprintf(fp, "#\t\t------  ------  ---------  ---------  ---------  ---------  ---------    ---------\n");
-    for (i = 0 ; i < MAX_BEAMS ; i++)
+    if (stream_files && result->stream_skipped)
     {
-        if (beam_count.total_depths[i] > 0)
-        {
-            bad_percent = (float)beam_count.bad[i] / 
-                (float)beam_count.total_depths[i] * 100.0;
+        fprintf (stderr, "The PFM depth file doesn't fit in half of the free memory so it wasn't streamed\n\n");
+        fflush (stderr);
+    }
 
-            good_percent = (float)beam_count.good[i] / 
-                (float)beam_count.total_depths[i] * 100.0;
 
-            fprintf(fp, "Beam %3d\t%5.1f   %5.1f   %9d  %9d  %9d  %9d  %9d  %9d\n", 
-                i + 1, bad_percent, good_percent, beam_count.bad[i], 
-                beam_count.good[i], beam_count.manual[i], beam_count.filter[i],
-                beam_count.pfm[i], beam_count.select[i]);
-        }
+    if (raster && !result->raster_saved)
+    {
+        fprintf (stderr, "Unable to write QC raster %s\n\n", raster_path);
+        fflush (stderr);
+    }
+
+
+    if (result->stats.bad_beams)
+    {
+        fprintf (stderr, "%lld soundings with beam numbers outside 0 - %d were skipped\n\n",
+                 (long long) result->stats.bad_beams, BEAM_TABLE_LIMIT - 1);
+        fflush (stderr);
     }
 
 
-    if (grand_total > 0)
+    /*  The report is still written (and the state saved) so the rest of the data isn't lost, but the exit
+        status says it's incomplete.  */
+
+    if (result->stats.read_errors)
     {
-        fprintf(fp, 
-            "#------------------------------------------------------------------------------------------------\n");
-        total_bad_percent = (float)total_bad / (float)grand_total * 100.0;
-        total_good_percent = (float)total_good / (float)grand_total * 100.0;
-	
+        fprintf (stderr, "%lld bins couldn't be read and were left out of the statistics\n\n",
+                 (long long) result->stats.read_errors);
+        fflush (stderr);
     }
 
-    fprintf(fp, "#All Beams\t%5.1f   %5.1f   %9d  %9d  %9d  %9d  %9d  %9d\n", 
-        total_bad_percent, total_good_percent, total_bad, total_good,
-        total_manual, total_filter, total_pfm, total_select); 
- 
 
-    fprintf(fp, "#\n#\n");
-    fprintf(fp, "#Total number of non-dropped beams: %d\n", total_good);
-    fprintf(fp, "#Total number of beams: %d\n", grand_total);
-    fprintf(fp, "#Total number of edited beams: %d\n", (total_manual+total_filter));
-    fprintf(fp, "#Total percent of edited beams: %5.2f\n", ((float)(total_manual+total_filter)/(float)total_good *100));
-    fprintf(fp, "#\n#\n#\n#\n#\n");
+    start_ns = profile_clock ();
+
+    if (beamstats_export (fp, result, format))
+    {
+        perror ("Writing report");
+        exit (-1);
+    }
+
 
+    if (save_state)
+    {
+        if (!state_path[0]) set_path (state_path, sizeof (state_path), "%s.bsstate", argv[optind]);
+
+        if (beamstats_save_state (state_path, result))
+        {
+            perror (state_path);
+            exit (-1);
+        }
+    }
 
 
-    fprintf (fp, 
-        "# BEAM #     RMS       MEAN DIFF          STD             STD%%    NEG%%   POS%%      MAX RESID    MEAN DEPTH    # POINTS\n#\n");
+    /*  The JSON report has the line table in it and it would break the CSV and binary ones, so those
+        only get it in a separate file.  */
 
-    for (i = min_beams ; i < max_beams ; i++)
+    if (line_stats && (format == FORMAT_TEXT || line_file))
     {
-        meandiff[i] = sum[i] / (float) (neg_count[i] + pos_count[i]);
-        meandepth[i] = depthtot[i] / (float) (neg_count[i] + pos_count[i]);
-        ss[i] = sum2[i] - (sum[i] * meandiff[i]);
-        var[i] = ss[i] / ((neg_count[i] + pos_count[i]) - 1);
-        stddev[i] = sqrt (var[i]);
-        sddepth[i] = (stddev[i] / meandepth[i]) * 100;
-        rms[i] = sqrt((double) (sum2[i] / (float) (neg_count[i] + 
-            pos_count[i])));
-        neg_percent[i] = ((float) neg_count[i] / (float) (neg_count[i] + 
-            pos_count[i])) * 100.0;
-        pos_percent[i] = ((float) pos_count[i] / (float) (neg_count[i] + 
-            pos_count[i])) * 100.0;
-
-        if (sum[i] != 0.0)
+        line_fp = fp;
+
+        if (line_file && (line_fp = fopen (line_file, "w")) == NULL)
         {
-          fprintf(fp, 
-                " %3d   %10.3f   %10.3f      %10.3f      %10.4f    %03d    %03d   %10.3f    %10.3f  %12d\n", 
-                i + 1, rms[i], meandiff[i], stddev[i], sddepth[i], 
-                NINT (neg_percent[i]), NINT (pos_percent[i]), 
-                max_val[i], meandepth[i], (neg_count[i] + pos_count[i]));
+            perror (line_file);
+            exit (-1);
         }
+
+        beamstats_line_report (line_fp, result);
+
+        if (line_fp != fp) fclose (line_fp);
     }
-    fprintf (fp, 
-        "#\n#The above represents the reference average filtered bin value\n");
-    fprintf (fp, 
-        "#from the PFM file minus the real depth values from the PFM file.\n");
-    fprintf (fp, 
-        "#Negatives indicate the depth values are deeper than the averages.\n");
 
     fclose (fp);
 
-    return (0);
+
+    if (profiling)
+    {
+        result->profile.report_ns = profile_clock () - start_ns;
+        result->profile.wall_ns = profile_clock () - wall_start_ns;
+
+        profile_report (&result->profile, result->threads, result->queue_depth, result->stream_bytes, json_fp);
+
+        if (json_fp != stderr) fclose (json_fp);
+    }
+
+    status = result->stats.read_errors ? -1 : 0;
+
+    beamstats_free_result (result);
+    if (roi) region_free (&region);
+
+    return (status);
 }
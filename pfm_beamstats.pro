@@ -1,5 +1,5 @@
 INCLUDEPATH += /c/PFM_ABEv7.0.0_Win64/include
-LIBS += -L /c/PFM_ABEv7.0.0_Win64/lib -lgsf -lpfm -lnvutility -lgdal -lxml2 -lpoppler -lm -liconv
+LIBS += -L /c/PFM_ABEv7.0.0_Win64/lib -lgsf -lpfm -lnvutility -lgdal -lxml2 -lpoppler -lpthread -lm -liconv
 DEFINES += NVWIN3X
 CONFIG += console
 CONFIG -= qt
@@ -14,5 +14,11 @@ DEPENDPATH += .
 INCLUDEPATH += .
 
 # Input
-HEADERS += version.h
-SOURCES += main.c
+HEADERS += band_cache.h batch.h beam_table.h beamstats.h benchmark.h bin_grid.h classify.h \
+           depth_stats.h engine.h engine_kernel.h export.h file_stream.h line_stats.h profile.h \
+           raster.h region.h report.h resid_sketch.h resid_stats.h row_reader.h sample.h \
+           sounding_buffer.h state.h synthetic.h tile_stats.h version.h
+SOURCES += band_cache.c batch.c beam_table.c beamstats.c benchmark.c bin_grid.c classify.c \
+           depth_stats.c engine.c export.c file_stream.c line_stats.c main.c profile.c raster.c \
+           region.c report.c resid_sketch.c resid_stats.c row_reader.c sample.c sounding_buffer.c \
+           state.c synthetic.c tile_stats.c
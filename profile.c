@@ -0,0 +1,164 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef NVLinux
+#include <sys/resource.h>
+#endif
+
+#include "profile.h"
+
+
+/*  Monotonic clock in nanoseconds.  */
+
+int64_t profile_clock ()
+{
+    struct timespec         ts;
+
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ((int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+
+
+void profile_add (PROFILE *total, PROFILE *part)
+{
+    total->open_ns += part->open_ns;
+    total->bin_read_ns += part->bin_read_ns;
+    total->depth_read_ns += part->depth_read_ns;
+    total->accumulate_ns += part->accumulate_ns;
+    total->wait_ns += part->wait_ns;
+    total->report_ns += part->report_ns;
+    total->bins += part->bins;
+    total->populated_bins += part->populated_bins;
+    total->soundings += part->soundings;
+    total->decoded_bytes += part->decoded_bytes;
+}
+
+
+
+/*  Bytes actually read from storage and bytes read through read system calls (which includes page cache
+    hits) from /proc/self/io.  Both are -1 if that isn't available.  */
+
+static void io_bytes (int64_t *storage_bytes, int64_t *syscall_bytes)
+{
+    FILE                    *fp;
+    char                    string[256];
+    long long               value;
+
+
+    *storage_bytes = *syscall_bytes = -1;
+
+    if ((fp = fopen ("/proc/self/io", "r")) == NULL) return;
+
+    while (fgets (string, sizeof (string), fp))
+    {
+        if (sscanf (string, "read_bytes: %lld", &value) == 1) *storage_bytes = value;
+        if (sscanf (string, "rchar: %lld", &value) == 1) *syscall_bytes = value;
+    }
+
+    fclose (fp);
+}
+
+
+
+/*  Peak resident set size in KB, or -1 if we can't tell.  */
+
+static int64_t peak_rss_kb ()
+{
+#ifdef NVLinux
+    struct rusage           usage;
+
+    if (!getrusage (RUSAGE_SELF, &usage)) return ((int64_t) usage.ru_maxrss);
+#endif
+
+    return (-1);
+}
+
+
+
+/*  Print the profile to stderr and, if json_fp isn't NULL, write it there as a single JSON object.  */
+
+void profile_report (PROFILE *profile, int32_t threads, int32_t queue_depth, int64_t stream_bytes,
+                     FILE *json_fp)
+{
+    double                  wall, bins_per_sec, soundings_per_sec;
+    int64_t                 storage_bytes, syscall_bytes, rss;
+
+
+    wall = (double) profile->wall_ns * 1.0e-9;
+    bins_per_sec = wall > 0.0 ? (double) profile->bins / wall : 0.0;
+    soundings_per_sec = wall > 0.0 ? (double) profile->soundings / wall : 0.0;
+
+    io_bytes (&storage_bytes, &syscall_bytes);
+    rss = peak_rss_kb ();
+
+
+    fprintf (stderr, "Profile (%d worker thread(s), read ahead %d rows)\n\n", threads, queue_depth);
+    fprintf (stderr, "  Open                  %12.3f s\n", (double) profile->open_ns * 1.0e-9);
+    fprintf (stderr, "  Bin record reads      %12.3f s (thread)\n", (double) profile->bin_read_ns * 1.0e-9);
+    fprintf (stderr, "  Depth reads           %12.3f s (thread)\n", (double) profile->depth_read_ns * 1.0e-9);
+    fprintf (stderr, "  Accumulation          %12.3f s (thread)\n", (double) profile->accumulate_ns * 1.0e-9);
+    fprintf (stderr, "  Waiting on reads      %12.3f s (thread)\n", (double) profile->wait_ns * 1.0e-9);
+    fprintf (stderr, "  Report                %12.3f s\n", (double) profile->report_ns * 1.0e-9);
+    fprintf (stderr, "  Wall                  %12.3f s\n\n", wall);
+    fprintf (stderr, "  Bins                  %12lld (%.0f/s)\n", (long long) profile->bins, bins_per_sec);
+    fprintf (stderr, "  Populated bins        %12lld\n", (long long) profile->populated_bins);
+    fprintf (stderr, "  Soundings             %12lld (%.0f/s)\n", (long long) profile->soundings, soundings_per_sec);
+    fprintf (stderr, "  Records decoded       %12lld bytes\n", (long long) profile->decoded_bytes);
+    if (storage_bytes >= 0)
+        fprintf (stderr, "  Read from storage     %12lld bytes\n", (long long) storage_bytes);
+    if (syscall_bytes >= 0)
+        fprintf (stderr, "  Read (incl. cache)    %12lld bytes\n", (long long) syscall_bytes);
+    if (stream_bytes)
+        fprintf (stderr, "  Streamed              %12lld bytes\n", (long long) stream_bytes);
+    if (rss >= 0)
+        fprintf (stderr, "  Peak RSS              %12lld KB\n", (long long) rss);
+    fprintf (stderr, "\n");
+    fflush (stderr);
+
+
+    if (json_fp == NULL) return;
+
+    fprintf (json_fp, "{\"threads\": %d, \"queue_depth\": %d, ", threads, queue_depth);
+    fprintf (json_fp, "\"open_s\": %.6f, \"bin_read_s\": %.6f, \"depth_read_s\": %.6f, ",
+             (double) profile->open_ns * 1.0e-9, (double) profile->bin_read_ns * 1.0e-9,
+             (double) profile->depth_read_ns * 1.0e-9);
+    fprintf (json_fp, "\"accumulate_s\": %.6f, \"wait_s\": %.6f, \"report_s\": %.6f, \"wall_s\": %.6f, ",
+             (double) profile->accumulate_ns * 1.0e-9, (double) profile->wait_ns * 1.0e-9,
+             (double) profile->report_ns * 1.0e-9, wall);
+    fprintf (json_fp, "\"bins\": %lld, \"populated_bins\": %lld, \"soundings\": %lld, ",
+             (long long) profile->bins, (long long) profile->populated_bins, (long long) profile->soundings);
+    fprintf (json_fp, "\"bins_per_s\": %.1f, \"soundings_per_s\": %.1f, \"decoded_bytes\": %lld, ",
+             bins_per_sec, soundings_per_sec, (long long) profile->decoded_bytes);
+    fprintf (json_fp, "\"storage_read_bytes\": %lld, \"read_bytes\": %lld, \"stream_bytes\": %lld, ",
+             (long long) storage_bytes, (long long) syscall_bytes, (long long) stream_bytes);
+    fprintf (json_fp, "\"peak_rss_kb\": %lld}\n", (long long) rss);
+    fflush (json_fp);
+}
@@ -0,0 +1,66 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+  /*  Phase timing and throughput counters for --profile.  Times are in nanoseconds.  Each reader and
+      worker thread keeps its own PROFILE and they're added together at the end so the read and
+      accumulate times are thread seconds, not wall time.  */
+
+  typedef struct
+  {
+    int64_t       open_ns;             /*  opening the PFM file(s)                  */
+    int64_t       bin_read_ns;         /*  read_bin_row                             */
+    int64_t       depth_read_ns;       /*  read_depth_array_index                   */
+    int64_t       accumulate_ns;       /*  classification and accumulation          */
+    int64_t       wait_ns;             /*  workers waiting on their reader          */
+    int64_t       report_ns;           /*  formatting and writing the report        */
+    int64_t       wall_ns;             /*  whole run                                */
+    int64_t       bins;                /*  bins visited                             */
+    int64_t       populated_bins;      /*  bins with at least one sounding          */
+    int64_t       soundings;           /*  soundings read                           */
+    int64_t       decoded_bytes;       /*  BIN_RECORD and DEPTH_RECORD bytes decoded */
+  } PROFILE;
+
+
+  int64_t profile_clock ();
+  void profile_add (PROFILE *total, PROFILE *part);
+  void profile_report (PROFILE *profile, int32_t threads, int32_t queue_depth, int64_t stream_bytes,
+                       FILE *json_fp);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,146 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpl_string.h"
+#include "ogr_srs_api.h"
+
+#include "raster.h"
+
+
+static char *layer_name[BIN_GRID_LAYERS] = {"RMS residual", "Maximum absolute residual", "Edited fraction",
+                                            "Distinct lines"};
+
+
+
+/*  Creates the GeoTIFF at "path" for "region" of the PFM described by "open_args".  Returns 0, or -1 if it
+    can't be created.  */
+
+int32_t raster_open (RASTER_WRITER *writer, char *path, PFM_OPEN_ARGS *open_args, REGION *region)
+{
+    GDALDriverH             driver;
+    GDALRasterBandH         band;
+    OGRSpatialReferenceH    srs;
+    char                    **create_options = NULL, *wkt = NULL;
+    double                  transform[6];
+    int32_t                 i;
+
+
+    memset (writer, 0, sizeof (RASTER_WRITER));
+
+    GDALAllRegister ();
+
+    if ((driver = GDALGetDriverByName ("GTiff")) == NULL) return (-1);
+
+
+    /*  Bands are written from the bottom up so the file isn't compressed (a compressed strip can't be
+        rewritten in place).  */
+
+    create_options = CSLSetNameValue (create_options, "BIGTIFF", "IF_SAFER");
+    create_options = CSLSetNameValue (create_options, "INTERLEAVE", "BAND");
+
+    writer->dataset = GDALCreate (driver, path, region->x1 - region->x0, region->y1 - region->y0, BIN_GRID_LAYERS,
+                                  GDT_Float32, create_options);
+
+    CSLDestroy (create_options);
+
+    if (writer->dataset == NULL) return (-1);
+
+    writer->x0 = region->x0;
+    writer->y1 = region->y1;
+
+
+    transform[0] = open_args->head.mbr.min_x + region->x0 * open_args->head.x_bin_size_degrees;
+    transform[1] = open_args->head.x_bin_size_degrees;
+    transform[2] = 0.0;
+    transform[3] = open_args->head.mbr.min_y + region->y1 * open_args->head.y_bin_size_degrees;
+    transform[4] = 0.0;
+    transform[5] = -open_args->head.y_bin_size_degrees;
+
+    GDALSetGeoTransform (writer->dataset, transform);
+
+    srs = OSRNewSpatialReference (NULL);
+    OSRSetWellKnownGeogCS (srs, "WGS84");
+    OSRExportToWkt (srs, &wkt);
+    GDALSetProjection (writer->dataset, wkt);
+    CPLFree (wkt);
+    OSRDestroySpatialReference (srs);
+
+    for (i = 0 ; i < BIN_GRID_LAYERS ; i++)
+    {
+        band = GDALGetRasterBand (writer->dataset, i + 1);
+        GDALSetDescription (band, layer_name[i]);
+        GDALSetRasterNoDataValue (band, BIN_GRID_NODATA);
+    }
+
+    return (0);
+}
+
+
+
+/*  MERGE_BAND callback ("data" is the RASTER_WRITER).  Only called from finish_band, one band at a time.
+    Bands without a grid (merged from elsewhere) are left as nodata.  */
+
+void raster_write_band (void *data, BEAM_STATS *part)
+{
+    RASTER_WRITER           *writer = (RASTER_WRITER *) data;
+    BIN_GRID                *grid = &part->grid;
+    GDALRasterBandH         band;
+    int32_t                 i, row;
+
+
+    if (!grid->value || writer->failed) return;
+
+    for (i = 0 ; i < BIN_GRID_LAYERS ; i++)
+    {
+        band = GDALGetRasterBand (writer->dataset, i + 1);
+
+        for (row = grid->y0 ; row < grid->y0 + grid->rows ; row++)
+        {
+            if (GDALRasterIO (band, GF_Write, grid->x0 - writer->x0, writer->y1 - 1 - row, grid->width, 1,
+                              bin_grid_row (grid, i, row), grid->width, 1, GDT_Float32, 0, 0) != CE_None)
+            {
+                writer->failed = NVTrue;
+                return;
+            }
+        }
+    }
+}
+
+
+
+/*  Flushes and closes the file.  Returns 0, or -1 if anything failed to be written.  */
+
+int32_t raster_close (RASTER_WRITER *writer)
+{
+    if (writer->dataset == NULL) return (-1);
+
+    GDALFlushCache (writer->dataset);
+    GDALClose (writer->dataset);
+    writer->dataset = NULL;
+
+    return (writer->failed ? -1 : 0);
+}
@@ -0,0 +1,63 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+#ifndef __RASTER_H__
+#define __RASTER_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include "nvutility.h"
+
+#include "pfm.h"
+
+#include "gdal.h"
+
+#include "engine.h"
+
+
+  /*  Writes the per bin QC layers (bin_grid.h) to a four band, 32 bit float, geographic (WGS84) GeoTIFF
+      covering the region processed.  raster_write_band is the engine's MERGE_BAND callback, so each band
+      of rows goes to GDAL (and its block cache) as soon as it's merged and the whole grid is never held
+      in memory.  The PFM's row 0 is the southern edge so rows are flipped on the way out.  */
+
+  typedef struct
+  {
+    GDALDatasetH  dataset;
+    int32_t       x0;                  /*  grid column of raster column 0           */
+    int32_t       y1;                  /*  one past the grid row of raster row 0    */
+    NV_BOOL       failed;              /*  a write failed                           */
+  } RASTER_WRITER;
+
+
+  int32_t raster_open (RASTER_WRITER *writer, char *path, PFM_OPEN_ARGS *open_args, REGION *region);
+  void raster_write_band (void *data, BEAM_STATS *part);
+  int32_t raster_close (RASTER_WRITER *writer);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,258 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "nvutility.h"
+
+#include "pfm.h"
+
+#include "region.h"
+
+
+/*  The whole grid.  */
+
+void region_grid (REGION *region, int32_t width, int32_t height)
+{
+    region->x0 = 0;
+    region->y0 = 0;
+    region->x1 = width;
+    region->y1 = height;
+    region->row_span = NULL;
+    region->span = NULL;
+}
+
+
+
+/*  A window of bins (x1 and y1 are one past the end), clipped to the grid.  Returns -1 if nothing is
+    left after clipping.  */
+
+int32_t region_window (REGION *region, int32_t width, int32_t height, int32_t x0, int32_t y0, int32_t x1,
+                       int32_t y1)
+{
+    region_grid (region, width, height);
+
+    if (x0 > region->x0) region->x0 = x0;
+    if (y0 > region->y0) region->y0 = y0;
+    if (x1 < region->x1) region->x1 = x1;
+    if (y1 < region->y1) region->y1 = y1;
+
+    if (region->x0 >= region->x1 || region->y0 >= region->y1) return (-1);
+
+    return (0);
+}
+
+
+
+/*  Column (or row) of the bin that contains "pos".  */
+
+static int32_t bin_of (double pos, double min, double bin_size)
+{
+    return ((int32_t) floor ((pos - min) / bin_size));
+}
+
+
+
+/*  The bins that overlap a lat/lon rectangle.  */
+
+int32_t region_bbox (REGION *region, PFM_OPEN_ARGS *open_args, NV_F64_XYMBR *mbr)
+{
+    PFM_HEADER              *head = &open_args->head;
+
+
+    return (region_window (region, head->bin_width, head->bin_height,
+                           bin_of (mbr->min_x, head->mbr.min_x, head->x_bin_size_degrees),
+                           bin_of (mbr->min_y, head->mbr.min_y, head->y_bin_size_degrees),
+                           bin_of (mbr->max_x, head->mbr.min_x, head->x_bin_size_degrees) + 1,
+                           bin_of (mbr->max_y, head->mbr.min_y, head->y_bin_size_degrees) + 1));
+}
+
+
+
+static int32_t compare_double (const void *a, const void *b)
+{
+    double da = *((double *) a), db = *((double *) b);
+
+
+    return (da < db ? -1 : da > db ? 1 : 0);
+}
+
+
+
+/*  The bins whose centers are inside a lon/lat polygon (even-odd rule).  The window is the polygon's
+    bounding box and each row gets the column spans between successive edge crossings at the row's
+    center latitude.  Returns -1 if no bins are inside.  */
+
+int32_t region_polygon (REGION *region, PFM_OPEN_ARGS *open_args, NV_F64_COORD2 *point, int32_t count)
+{
+    PFM_HEADER              *head = &open_args->head;
+    NV_F64_XYMBR            mbr;
+    double                  *cross, lat, lon;
+    int32_t                 i, j, k, n, rows, spans = 0, max_spans = 0, x0, x1;
+
+
+    if (count < 3) return (-1);
+
+    mbr.min_x = mbr.max_x = point[0].x;
+    mbr.min_y = mbr.max_y = point[0].y;
+
+    for (i = 1 ; i < count ; i++)
+    {
+        if (point[i].x < mbr.min_x) mbr.min_x = point[i].x;
+        if (point[i].x > mbr.max_x) mbr.max_x = point[i].x;
+        if (point[i].y < mbr.min_y) mbr.min_y = point[i].y;
+        if (point[i].y > mbr.max_y) mbr.max_y = point[i].y;
+    }
+
+    if (region_bbox (region, open_args, &mbr)) return (-1);
+
+
+    rows = region->y1 - region->y0;
+
+    if ((cross = (double *) malloc (count * sizeof (double))) == NULL ||
+        (region->row_span = (int32_t *) malloc ((rows + 1) * sizeof (int32_t))) == NULL)
+    {
+        perror ("Allocating polygon region");
+        exit (-1);
+    }
+
+
+    for (i = 0 ; i < rows ; i++)
+    {
+        region->row_span[i] = spans;
+
+        lat = head->mbr.min_y + ((region->y0 + i) + 0.5) * head->y_bin_size_degrees;
+
+
+        /*  Longitudes where the edges cross this latitude.  */
+
+        for (j = 0, k = count - 1, n = 0 ; j < count ; k = j++)
+        {
+            if ((point[j].y > lat) != (point[k].y > lat))
+                cross[n++] = point[j].x + (lat - point[j].y) / (point[k].y - point[j].y) * (point[k].x - point[j].x);
+        }
+
+        qsort (cross, n, sizeof (double), compare_double);
+
+
+        /*  Bins whose centers fall between each pair of crossings.  */
+
+        for (j = 0 ; j + 1 < n ; j += 2)
+        {
+            lon = (cross[j] - head->mbr.min_x) / head->x_bin_size_degrees - 0.5;
+            x0 = (int32_t) ceil (lon);
+            lon = (cross[j + 1] - head->mbr.min_x) / head->x_bin_size_degrees - 0.5;
+            x1 = (int32_t) floor (lon) + 1;
+
+            if (x0 < region->x0) x0 = region->x0;
+            if (x1 > region->x1) x1 = region->x1;
+            if (x0 >= x1) continue;
+
+            if (spans == max_spans)
+            {
+                max_spans = max_spans ? max_spans * 2 : 1024;
+
+                if ((region->span = (NV_I32_COORD2 *) realloc (region->span, max_spans * sizeof (NV_I32_COORD2))) == NULL)
+                {
+                    perror ("Allocating polygon spans");
+                    exit (-1);
+                }
+            }
+
+            region->span[spans].x = x0;
+            region->span[spans].y = x1;
+            spans++;
+        }
+    }
+
+    region->row_span[rows] = spans;
+
+    free (cross);
+
+    if (!spans)
+    {
+        region_free (region);
+        return (-1);
+    }
+
+    return (0);
+}
+
+
+
+/*  Read a polygon, one "longitude latitude" (or "longitude,latitude") vertex per line.  Blank lines and
+    lines starting with # are skipped.  Returns the number of vertices, or -1 if the file can't be read.
+    The caller frees "point".  */
+
+int32_t read_polygon_file (char *path, NV_F64_COORD2 **point)
+{
+    FILE                    *fp;
+    char                    string[256];
+    int32_t                 count = 0, max_count = 0;
+    double                  x, y;
+
+
+    if ((fp = fopen (path, "r")) == NULL) return (-1);
+
+    *point = NULL;
+
+    while (fgets (string, sizeof (string), fp) != NULL)
+    {
+        if (string[0] == '#') continue;
+
+        if (sscanf (string, "%lf%*[ ,\t]%lf", &x, &y) != 2) continue;
+
+        if (count == max_count)
+        {
+            max_count = max_count ? max_count * 2 : 64;
+
+            if ((*point = (NV_F64_COORD2 *) realloc (*point, max_count * sizeof (NV_F64_COORD2))) == NULL)
+            {
+                perror ("Allocating polygon");
+                exit (-1);
+            }
+        }
+
+        (*point)[count].x = x;
+        (*point)[count].y = y;
+        count++;
+    }
+
+    fclose (fp);
+
+    return (count);
+}
+
+
+
+void region_free (REGION *region)
+{
+    if (region->row_span) free (region->row_span);
+    if (region->span) free (region->span);
+
+    region->row_span = NULL;
+    region->span = NULL;
+}
@@ -0,0 +1,64 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __REGION_H__
+#define __REGION_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include "nvutility.h"
+
+#include "pfm.h"
+
+
+  /*  The part of the bin grid to process.  The window x0 <= x < x1, y0 <= y < y1 bounds the rows and
+      columns that are read at all.  For a polygon each row also has a list of column spans (bins whose
+      centers are inside the polygon) and only those bins' soundings are read.  */
+
+  typedef struct
+  {
+    int32_t       x0, y0;              /*  first column and row                     */
+    int32_t       x1, y1;              /*  one past the last column and row         */
+    int32_t       *row_span;           /*  first span of each row (y1 - y0 + 1),   */
+                                       /*  NULL for the whole window                */
+    NV_I32_COORD2 *span;               /*  column spans, x = first, y = one past    */
+  } REGION;
+
+
+  void region_grid (REGION *region, int32_t width, int32_t height);
+  int32_t region_window (REGION *region, int32_t width, int32_t height, int32_t x0, int32_t y0, int32_t x1,
+                         int32_t y1);
+  int32_t region_bbox (REGION *region, PFM_OPEN_ARGS *open_args, NV_F64_XYMBR *mbr);
+  int32_t region_polygon (REGION *region, PFM_OPEN_ARGS *open_args, NV_F64_COORD2 *point, int32_t count);
+  int32_t read_polygon_file (char *path, NV_F64_COORD2 **point);
+  void region_free (REGION *region);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,345 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "nvutility.h"
+
+#include "report.h"
+
+
+/*  One line per tile that has any soundings, with the tile's corner bin and center position.  */
+
+static void tile_report (FILE *fp, BEAMSTATS_RESULT *result)
+{
+    TILE_GRID               *tiles = &result->stats.tiles;
+    TILE_STATS              *tile;
+    int32_t                 i, j, bin_x, bin_y, w, h;
+    double                  lon, lat;
+
+
+    fprintf (fp, "#\n#\n#Tile Stats (%d x %d bins)\n#\n", tiles->size, tiles->size);
+    fprintf (fp, 
+        "# TILE X  TILE Y   BIN X   BIN Y      LONGITUDE       LATITUDE  GOOD BINS  200%% BINS      #GOOD       #BAD  %%EDITED         RMS   MEAN DIFF         STD\n#\n");
+
+    for (i = 0 ; i < tiles->rows ; i++)
+    {
+        for (j = 0 ; j < tiles->columns ; j++)
+        {
+            tile = &tiles->tile[i * tiles->columns + j];
+
+            if (!tile->good && !tile->bad) continue;
+
+            bin_x = tiles->x0 + j * tiles->size;
+            bin_y = tiles->y0 + (tiles->first_row + i) * tiles->size;
+            w = result->region.x1 - bin_x < tiles->size ? result->region.x1 - bin_x : tiles->size;
+            h = result->region.y1 - bin_y < tiles->size ? result->region.y1 - bin_y : tiles->size;
+            lon = result->mbr.min_x + (bin_x + w / 2.0) * result->x_bin_size_degrees;
+            lat = result->mbr.min_y + (bin_y + h / 2.0) * result->y_bin_size_degrees;
+
+            fprintf (fp, " %7d %7d %7d %7d  %13.8f  %13.8f  %9lld  %9lld  %9lld  %9lld  %7.2f  %10.3f  %10.3f  %10.3f\n",
+                     j, tiles->first_row + i, bin_x, bin_y, lon, lat, (long long) tile->bin_count,
+                     (long long) tile->bin2_count, (long long) tile->good, (long long) tile->bad, (double) tile->bad / (double) (tile->good + tile->bad) * 100.0,
+                     resid_stats_rms (&tile->resid), tile->resid.mean, sqrt (resid_stats_variance (&tile->resid)));
+        }
+    }
+}
+
+
+
+/*  Residual percentiles from the per beam sketches and the percentage of residuals within the TVU
+    limit.  Columns that weren't collected are printed as "-".  */
+
+static void quantile_report (FILE *fp, BEAMSTATS_RESULT *result)
+{
+    BEAM_STATS              *total = &result->stats;
+    BEAM_RECORD             *beam;
+    RESID_SKETCH            *sketch;
+    int32_t                 i;
+    char                    median[32], p95[32], p99[32], tvu[32];
+
+
+    fprintf (fp, "#\n#\n#Residual Percentiles");
+    if (total->sketches.size) fprintf (fp, "  (within %.0f%% of the true value)", SKETCH_ACCURACY * 100.0);
+    fprintf (fp, "\n#\n");
+
+    if (total->tvu)
+        fprintf (fp, "#TVU:  sqrt (%.3f^2 + (%.4f * depth)^2)\n#\n", sqrt (total->tvu_a2), sqrt (total->tvu_b2));
+
+    fprintf (fp, "# BEAM #      MEDIAN    P95 |DIFF|    P99 |DIFF|     %%TVU    # POINTS\n#\n");
+
+    for (i = 0 ; i < total->beams.size ; i++)
+    {
+        beam = &total->beams.beam[i];
+
+        if (!beam->resid.count) continue;
+
+        strcpy (median, "-");
+        strcpy (p95, "-");
+        strcpy (p99, "-");
+        strcpy (tvu, "-");
+
+        if (i < total->sketches.size)
+        {
+            sketch = &total->sketches.sketch[i];
+
+            sprintf (median, "%.3f", resid_sketch_quantile (sketch, 0.5));
+            sprintf (p95, "%.3f", resid_sketch_abs_quantile (sketch, 0.95));
+            sprintf (p99, "%.3f", resid_sketch_abs_quantile (sketch, 0.99));
+        }
+
+        if (total->tvu)
+            sprintf (tvu, "%.2f", (double) total->beams.count[i].tvu_pass / (double) beam->resid.count * 100.0);
+
+        fprintf (fp, "   %3d    %10s    %10s    %10s   %7s  %10lld\n", i + 1, median, p95, p99, tvu,
+                 (long long) beam->resid.count);
+    }
+}
+
+
+
+/*  The repeatability table again for each depth band that has any residuals.  */
+
+static void depth_report (FILE *fp, BEAMSTATS_RESULT *result)
+{
+    DEPTH_TABLE             *depths = &result->stats.depths;
+    RESID_STATS             *resid;
+    int32_t                 i, k, bands = depths->num_edges + 1;
+    int64_t                 count;
+    double                  stddev;
+
+
+    fprintf (fp, "#\n#\n#Repeatability by Depth\n");
+
+    for (k = 0 ; k < bands ; k++)
+    {
+        for (i = 0, count = 0 ; i < depths->beams ; i++) count += depths->cell[i * bands + k].count;
+
+        if (!count) continue;
+
+        if (!k) fprintf (fp, "#\n#Depth less than %.1f m\n#\n", depths->edge[0]);
+        else if (k == depths->num_edges) fprintf (fp, "#\n#Depth %.1f m or more\n#\n", depths->edge[k - 1]);
+        else fprintf (fp, "#\n#Depth %.1f - %.1f m\n#\n", depths->edge[k - 1], depths->edge[k]);
+
+        fprintf (fp,
+            "# BEAM #     RMS       MEAN DIFF          STD             STD%%      MAX RESID    MEAN DEPTH    # POINTS\n#\n");
+
+        for (i = 0 ; i < depths->beams ; i++)
+        {
+            resid = &depths->cell[i * bands + k];
+
+            if (!resid->count) continue;
+
+            stddev = sqrt (resid_stats_variance (resid));
+
+            fprintf (fp, " %3d   %10.3f   %10.3f      %10.3f      %10.4f   %10.3f    %10.3f  %12lld\n", i + 1,
+                     resid_stats_rms (resid), resid->mean, stddev, stddev / resid->mean_depth * 100.0, resid->max_val,
+                     resid->mean_depth, (long long) resid->count);
+        }
+    }
+}
+
+
+
+/*  The text report (gnuplot friendly, comments start with #).  */
+
+void beamstats_report (FILE *fp, BEAMSTATS_RESULT *result)
+{
+    BEAM_STATS              *total = &result->stats;
+    BEAM_COUNTS             *beam;
+    RESID_STATS             *resid;
+    int32_t                 i;
+    double                  bad_percent, good_percent, total_bad_percent = 0.0, total_good_percent = 0.0;
+    double                  rms, meandiff, meandepth, stddev, sddepth, neg_percent, pos_percent;
+
+
+    fprintf(fp, "#\n#Filename:  %s\n", result->list_path);
+    if (result->subset)
+        fprintf(fp, "#\n#Bins:  columns %d - %d, rows %d - %d\n", result->region.x0, result->region.x1 - 1,
+                result->region.y0, result->region.y1 - 1);
+    fprintf(fp, "#\n#Square kilometers covered:  %f\n", result->square_kilometers);
+    fprintf(fp, "#\n#Square nautical miles covered:  %f\n", result->square_nmiles);
+    fprintf(fp, "#\n#Square kilometers covered at 200%% or better:  %f  (%.1f%%)\n", 
+            result->s2_kilos, result->s2_kilos / result->square_kilometers * 100.0);
+    fprintf(fp, "#\n#Square nautical miles covered at 200%% or better:  %f  (%.1f%%)\n", 
+            result->s2_nmiles, result->s2_nmiles / result->square_nmiles * 100.0);
+
+    for (i = 2 ; i < COVERAGE_LEVELS ; i++)
+    {
+        fprintf(fp, "#\n#Square kilometers covered at %d%% or better:  %f  (%.1f%%)\n", (i + 1) * 100,
+                result->coverage_kilos[i], result->coverage_kilos[i] / result->square_kilometers * 100.0);
+        fprintf(fp, "#\n#Square nautical miles covered at %d%% or better:  %f  (%.1f%%)\n", (i + 1) * 100,
+                result->coverage_nmiles[i], result->coverage_nmiles[i] / result->square_nmiles * 100.0);
+    }
+   
+    fprintf(fp, "#\n#\n");
+    fprintf(fp, "#Beam Stats\n");
+    fprintf(fp, "#---------------------------\n\n");
+
+
+    fprintf(fp, "#\t\t  %%BAD   %%GOOD    #BAD       #GOOD     #MANUAL    #FILTER      #PFM      #SELECTED\n");
+    fprintf(fp, "#\t\t------  ------  ---------  ---------  ---------  ---------  ---------    ---------\n");
+    for (i = 0 ; i < total->beams.size ; i++)
+    {
+        beam = &total->beams.count[i];
+
+        if (beam->total_depths > 0)
+        {
+            bad_percent = (double)beam->bad / 
+                (double)beam->total_depths * 100.0;
+
+            good_percent = (double)beam->good / 
+                (double)beam->total_depths * 100.0;
+
+            fprintf(fp, "Beam %3d\t%5.1f   %5.1f   %9lld  %9lld  %9lld  %9lld  %9lld  %9lld\n", 
+                i + 1, bad_percent, good_percent, (long long) beam->bad, 
+                (long long) beam->good, (long long) beam->manual, (long long) beam->filter,
+                (long long) beam->pfm, (long long) beam->select);
+        }
+    }
+
+
+    if (result->grand_total > 0)
+    {
+        fprintf(fp, 
+            "#------------------------------------------------------------------------------------------------\n");
+        total_bad_percent = (double)total->total_bad / (double)result->grand_total * 100.0;
+        total_good_percent = (double)total->total_good / (double)result->grand_total * 100.0;
+    }
+
+    fprintf(fp, "#All Beams\t%5.1f   %5.1f   %9lld  %9lld  %9lld  %9lld  %9lld  %9lld\n", 
+        total_bad_percent, total_good_percent, (long long) total->total_bad, (long long) total->total_good,
+        (long long) total->total_manual, (long long) total->total_filter, (long long) total->total_pfm,
+        (long long) total->total_select); 
+ 
+
+    fprintf(fp, "#\n#\n");
+    fprintf(fp, "#Total number of non-dropped beams: %lld\n", (long long) total->total_good);
+    fprintf(fp, "#Total number of beams: %lld\n", (long long) result->grand_total);
+    fprintf(fp, "#Total number of edited beams: %lld\n", (long long) (total->total_manual+total->total_filter));
+    fprintf(fp, "#Total percent of edited beams: %5.2f\n",
+            ((double)(total->total_manual+total->total_filter)/(double)total->total_good *100));
+    fprintf(fp, "#\n#\n#\n#\n#\n");
+
+
+
+    if (total->counts_only)
+    {
+        fprintf (fp, "#Repeatability statistics were not collected (--counts-only)\n");
+    }
+    else
+    {
+        fprintf (fp, 
+            "# BEAM #     RMS       MEAN DIFF          STD             STD%%    NEG%%   POS%%      MAX RESID    MEAN DEPTH    # POINTS\n#\n");
+
+        for (i = 0 ; i < total->beams.size ; i++)
+        {
+            resid = &total->beams.beam[i].resid;
+
+            if (resid->count)
+            {
+                meandiff = resid->mean;
+                meandepth = resid->mean_depth;
+                stddev = sqrt (resid_stats_variance (resid));
+                sddepth = (stddev / meandepth) * 100.0;
+                rms = resid_stats_rms (resid);
+                neg_percent = ((double) resid->neg_count / (double) resid->count) * 100.0;
+                pos_percent = ((double) (resid->count - resid->neg_count) / (double) resid->count) * 100.0;
+
+                fprintf(fp, 
+                    " %3d   %10.3f   %10.3f      %10.3f      %10.4f    %03d    %03d   %10.3f    %10.3f  %12lld\n", 
+                    i + 1, rms, meandiff, stddev, sddepth, NINT (neg_percent), NINT (pos_percent), 
+                    resid->max_val, meandepth, (long long) resid->count);
+            }
+        }
+        fprintf (fp, 
+            "#\n#The above represents the reference average filtered bin value\n");
+        fprintf (fp, 
+            "#from the PFM file minus the real depth values from the PFM file.\n");
+        fprintf (fp, 
+            "#Negatives indicate the depth values are deeper than the averages.\n");
+    }
+
+    if (result->stats.sketches.size || result->stats.tvu) quantile_report (fp, result);
+    if (result->stats.depths.num_edges) depth_report (fp, result);
+    if (result->stats.tiles.tile) tile_report (fp, result);
+}
+
+
+
+/*  The repeatability table broken down by survey line (only if line statistics were collected).  */
+
+void beamstats_line_report (FILE *fp, BEAMSTATS_RESULT *result)
+{
+    LINE_BEAM               *sorted, *line_beam;
+    RESID_STATS             *resid;
+    int32_t                 i, k;
+    double                  rms, meandiff, meandepth, stddev, sddepth, neg_percent, pos_percent;
+
+
+    if (!result->stats.lines.capacity) return;
+
+    fprintf (fp, "#\n#\n#Line Stats\n#\n");
+
+    for (i = 0 ; i < result->num_lines ; i++) fprintf (fp, "#Line %5d:  %s\n", result->line[i], result->line_name[i]);
+
+    fprintf (fp, "#\n");
+    fprintf (fp, 
+        "#  LINE BEAM #     RMS       MEAN DIFF          STD             STD%%    NEG%%   POS%%      MAX RESID    MEAN DEPTH    # POINTS      #GOOD       #BAD\n#\n");
+
+    sorted = line_table_sort (&result->stats.lines);
+
+    for (k = 0 ; k < result->stats.lines.size ; k++)
+    {
+        line_beam = &sorted[k];
+        resid = &line_beam->resid;
+
+        if (resid->count)
+        {
+            meandiff = resid->mean;
+            meandepth = resid->mean_depth;
+            stddev = sqrt (resid_stats_variance (resid));
+            sddepth = (stddev / meandepth) * 100.0;
+            rms = resid_stats_rms (resid);
+            neg_percent = ((double) resid->neg_count / (double) resid->count) * 100.0;
+            pos_percent = ((double) (resid->count - resid->neg_count) / (double) resid->count) * 100.0;
+
+            fprintf (fp, 
+                " %6d  %3d   %10.3f   %10.3f      %10.3f      %10.4f    %03d    %03d   %10.3f    %10.3f  %12lld  %9lld  %9lld\n", 
+                (int16_t) (line_beam->key >> 16), (line_beam->key & 0xffff) + 1, rms, meandiff, stddev, sddepth,
+                NINT (neg_percent), NINT (pos_percent), resid->max_val, meandepth, (long long) resid->count,
+                (long long) line_beam->good, (long long) line_beam->bad);
+        }
+        else
+        {
+            fprintf (fp, " %6d  %3d   %10s   %10s      %10s      %10s    %3s    %3s   %10s    %10s  %12d  %9lld  %9lld\n",
+                     (int16_t) (line_beam->key >> 16), (line_beam->key & 0xffff) + 1, "-", "-", "-", "-", "-", "-",
+                     "-", "-", 0, (long long) line_beam->good, (long long) line_beam->bad);
+        }
+    }
+
+    free (sorted);
+}
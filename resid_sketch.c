@@ -0,0 +1,378 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "resid_sketch.h"
+
+
+/*  GCC folds these to constants.  */
+
+#define LOG_GAMMA         log ((1.0 + SKETCH_ACCURACY) / (1.0 - SKETCH_ACCURACY))
+#define MIN_KEY           ((int32_t) ceil (log (SKETCH_MIN) / LOG_GAMMA))
+#define MAX_KEY           ((int32_t) ceil (log (SKETCH_MAX) / LOG_GAMMA))
+
+
+/*  Buckets added on each side when a store has to grow, so that a beam's stores settle after a few
+    reallocations.  */
+
+#define STORE_SLACK       32
+
+
+static int32_t bucket_key (double magnitude)
+{
+    int32_t                 key;
+
+
+    key = (int32_t) ceil (log (magnitude) / LOG_GAMMA);
+
+    if (key < MIN_KEY) key = MIN_KEY;
+    if (key > MAX_KEY) key = MAX_KEY;
+
+    return (key);
+}
+
+
+
+/*  Middle of bucket "key" (within SKETCH_ACCURACY of everything in it).  */
+
+static double bucket_value (int32_t key)
+{
+    double gamma = (1.0 + SKETCH_ACCURACY) / (1.0 - SKETCH_ACCURACY);
+
+
+    return (2.0 * pow (gamma, key) / (gamma + 1.0));
+}
+
+
+
+/*  Make sure "store" has buckets "lo" through "hi".  */
+
+static void store_extend (SKETCH_STORE *store, int32_t lo, int32_t hi)
+{
+    int64_t                 *count;
+    int32_t                 offset, size;
+
+
+    if (store->size)
+    {
+        if (lo >= store->offset && hi < store->offset + store->size) return;
+
+        if (store->offset < lo) lo = store->offset;
+        if (store->offset + store->size - 1 > hi) hi = store->offset + store->size - 1;
+    }
+
+    offset = lo - STORE_SLACK;
+    if (offset < MIN_KEY) offset = MIN_KEY;
+
+    size = hi + STORE_SLACK - offset + 1;
+    if (offset + size - 1 > MAX_KEY) size = MAX_KEY - offset + 1;
+
+    if ((count = (int64_t *) calloc (size, sizeof (int64_t))) == NULL)
+    {
+        perror ("Allocating residual sketch");
+        exit (-1);
+    }
+
+    if (store->size)
+    {
+        memcpy (&count[store->offset - offset], store->count, store->size * sizeof (int64_t));
+        free (store->count);
+    }
+
+    store->count = count;
+    store->offset = offset;
+    store->size = size;
+}
+
+
+
+static void store_merge (SKETCH_STORE *total, SKETCH_STORE *part)
+{
+    int32_t                 i;
+
+
+    if (!part->size) return;
+
+    store_extend (total, part->offset, part->offset + part->size - 1);
+
+    for (i = 0 ; i < part->size ; i++) total->count[part->offset - total->offset + i] += part->count[i];
+}
+
+
+
+static int64_t store_count (SKETCH_STORE *store, int32_t key)
+{
+    if (key < store->offset || key >= store->offset + store->size) return (0);
+
+    return (store->count[key - store->offset]);
+}
+
+
+
+void resid_sketch_add (RESID_SKETCH *sketch, double value)
+{
+    SKETCH_STORE            *store;
+    int32_t                 key;
+
+
+    sketch->count++;
+
+    if (fabs (value) < SKETCH_MIN)
+    {
+        sketch->zero++;
+        return;
+    }
+
+    store = value > 0.0 ? &sketch->pos : &sketch->neg;
+    key = bucket_key (fabs (value));
+
+    store_extend (store, key, key);
+    store->count[key - store->offset]++;
+}
+
+
+
+void resid_sketch_merge (RESID_SKETCH *total, RESID_SKETCH *part)
+{
+    store_merge (&total->pos, &part->pos);
+    store_merge (&total->neg, &part->neg);
+
+    total->zero += part->zero;
+    total->count += part->count;
+}
+
+
+
+/*  Estimated "q" quantile (0 to 1) of the signed residuals.  Returns 0 for an empty sketch.  */
+
+double resid_sketch_quantile (RESID_SKETCH *sketch, double q)
+{
+    double                  rank;
+    int64_t                 seen = 0;
+    int32_t                 i;
+
+
+    if (!sketch->count) return (0.0);
+
+    rank = q * (sketch->count - 1);
+
+
+    /*  Most negative first.  */
+
+    for (i = sketch->neg.size - 1 ; i >= 0 ; i--)
+    {
+        seen += sketch->neg.count[i];
+        if (seen > rank) return (-bucket_value (sketch->neg.offset + i));
+    }
+
+    seen += sketch->zero;
+    if (seen > rank) return (0.0);
+
+    for (i = 0 ; i < sketch->pos.size ; i++)
+    {
+        seen += sketch->pos.count[i];
+        if (seen > rank) return (bucket_value (sketch->pos.offset + i));
+    }
+
+    return (bucket_value (sketch->pos.offset + sketch->pos.size - 1));
+}
+
+
+
+/*  Estimated "q" quantile of the residual magnitudes.  */
+
+double resid_sketch_abs_quantile (RESID_SKETCH *sketch, double q)
+{
+    double                  rank;
+    int64_t                 seen;
+    int32_t                 key, lo = MAX_KEY, hi = MIN_KEY;
+
+
+    if (!sketch->count) return (0.0);
+
+    rank = q * (sketch->count - 1);
+
+    seen = sketch->zero;
+    if (seen > rank) return (0.0);
+
+    if (sketch->pos.size)
+    {
+        lo = sketch->pos.offset;
+        hi = sketch->pos.offset + sketch->pos.size - 1;
+    }
+
+    if (sketch->neg.size)
+    {
+        if (sketch->neg.offset < lo) lo = sketch->neg.offset;
+        if (sketch->neg.offset + sketch->neg.size - 1 > hi) hi = sketch->neg.offset + sketch->neg.size - 1;
+    }
+
+    for (key = lo ; key <= hi ; key++)
+    {
+        seen += store_count (&sketch->pos, key) + store_count (&sketch->neg, key);
+        if (seen > rank) return (bucket_value (key));
+    }
+
+    return (bucket_value (hi));
+}
+
+
+
+void resid_sketch_free (RESID_SKETCH *sketch)
+{
+    if (sketch->pos.count) free (sketch->pos.count);
+    if (sketch->neg.count) free (sketch->neg.count);
+
+    memset (sketch, 0, sizeof (RESID_SKETCH));
+}
+
+
+
+/*  Write the sketch as its counts, bucket ranges, and buckets.  Returns 0 or -1.  */
+
+int32_t resid_sketch_write (FILE *fp, RESID_SKETCH *sketch)
+{
+    int64_t                 head[6];
+
+
+    head[0] = sketch->count;
+    head[1] = sketch->zero;
+    head[2] = sketch->pos.offset;
+    head[3] = sketch->pos.size;
+    head[4] = sketch->neg.offset;
+    head[5] = sketch->neg.size;
+
+    if (fwrite (head, sizeof (int64_t), 6, fp) != 6 ||
+        fwrite (sketch->pos.count, sizeof (int64_t), sketch->pos.size, fp) != (size_t) sketch->pos.size ||
+        fwrite (sketch->neg.count, sizeof (int64_t), sketch->neg.size, fp) != (size_t) sketch->neg.size) return (-1);
+
+    return (0);
+}
+
+
+
+static int32_t store_read (FILE *fp, SKETCH_STORE *store, int64_t offset, int64_t size)
+{
+    if (!size) return (0);
+
+    if (size < 0 || offset < MIN_KEY || offset + size - 1 > MAX_KEY) return (-1);
+
+    store_extend (store, (int32_t) offset, (int32_t) (offset + size - 1));
+
+    if (fread (&store->count[offset - store->offset], sizeof (int64_t), size, fp) != (size_t) size) return (-1);
+
+    return (0);
+}
+
+
+
+/*  Read a sketch written by resid_sketch_write into an empty "sketch".  Returns 0 or -1 (the sketch is
+    left empty).  */
+
+int32_t resid_sketch_read (FILE *fp, RESID_SKETCH *sketch)
+{
+    int64_t                 head[6];
+
+
+    if (fread (head, sizeof (int64_t), 6, fp) != 6 || store_read (fp, &sketch->pos, head[2], head[3]) ||
+        store_read (fp, &sketch->neg, head[4], head[5]))
+    {
+        resid_sketch_free (sketch);
+        return (-1);
+    }
+
+    sketch->count = head[0];
+    sketch->zero = head[1];
+
+    return (0);
+}
+
+
+
+void sketch_table_init (SKETCH_TABLE *table, int32_t size)
+{
+    if ((table->sketch = (RESID_SKETCH *) calloc (size, sizeof (RESID_SKETCH))) == NULL)
+    {
+        perror ("Allocating residual sketches");
+        exit (-1);
+    }
+
+    table->size = size;
+}
+
+
+
+void sketch_table_free (SKETCH_TABLE *table)
+{
+    int32_t                 i;
+
+
+    for (i = 0 ; i < table->size ; i++) resid_sketch_free (&table->sketch[i]);
+
+    if (table->sketch) free (table->sketch);
+
+    memset (table, 0, sizeof (SKETCH_TABLE));
+}
+
+
+
+/*  Sketch for "beam", growing the table if needed.  */
+
+RESID_SKETCH *sketch_table_get (SKETCH_TABLE *table, int32_t beam)
+{
+    int32_t                 size;
+
+
+    if (beam >= table->size)
+    {
+        for (size = table->size ? table->size : 1 ; size <= beam ; size *= 2);
+
+        if ((table->sketch = (RESID_SKETCH *) realloc (table->sketch, size * sizeof (RESID_SKETCH))) == NULL)
+        {
+            perror ("Allocating residual sketches");
+            exit (-1);
+        }
+
+        memset (&table->sketch[table->size], 0, (size - table->size) * sizeof (RESID_SKETCH));
+        table->size = size;
+    }
+
+    return (&table->sketch[beam]);
+}
+
+
+
+void sketch_table_merge (SKETCH_TABLE *total, SKETCH_TABLE *part)
+{
+    int32_t                 i;
+
+
+    for (i = 0 ; i < part->size ; i++)
+    {
+        if (part->sketch[i].count) resid_sketch_merge (sketch_table_get (total, i), &part->sketch[i]);
+    }
+}
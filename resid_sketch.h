@@ -0,0 +1,96 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __RESID_SKETCH_H__
+#define __RESID_SKETCH_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+  /*  Residual quantiles are estimated to within SKETCH_ACCURACY relative error.  Magnitudes below
+      SKETCH_MIN count as zero and magnitudes above SKETCH_MAX go in the top bucket, which bounds each
+      store at about 1040 counters.  */
+
+#define       SKETCH_ACCURACY      0.01
+#define       SKETCH_MIN           0.0001
+#define       SKETCH_MAX           100000.0
+
+
+  /*  Counts of residual magnitudes in logarithmically sized buckets (bucket i holds gamma^(i-1) < |r| <=
+      gamma^i where gamma = (1 + SKETCH_ACCURACY) / (1 - SKETCH_ACCURACY)).  Only the buckets between
+      the smallest and largest ones used are allocated.  */
+
+  typedef struct
+  {
+    int32_t       offset;              /*  bucket index of count[0]                 */
+    int32_t       size;                /*  number of buckets held                   */
+    int64_t       *count;
+  } SKETCH_STORE;
+
+
+  /*  A mergeable quantile sketch of one beam's residuals (a DDSketch).  Merging adds the bucket counts so
+      the result doesn't depend on the order partial sketches are merged in.  */
+
+  typedef struct
+  {
+    SKETCH_STORE  pos;                 /*  positive residuals                       */
+    SKETCH_STORE  neg;                 /*  magnitudes of negative residuals         */
+    int64_t       zero;                /*  residuals smaller than SKETCH_MIN        */
+    int64_t       count;               /*  total residuals                          */
+  } RESID_SKETCH;
+
+
+  /*  One sketch per beam, grown along with the beam table.  */
+
+  typedef struct
+  {
+    int32_t       size;                /*  sketches allocated (0 = no sketches)     */
+    RESID_SKETCH  *sketch;
+  } SKETCH_TABLE;
+
+
+  void resid_sketch_add (RESID_SKETCH *sketch, double value);
+  void resid_sketch_merge (RESID_SKETCH *total, RESID_SKETCH *part);
+  double resid_sketch_quantile (RESID_SKETCH *sketch, double q);
+  double resid_sketch_abs_quantile (RESID_SKETCH *sketch, double q);
+  void resid_sketch_free (RESID_SKETCH *sketch);
+  int32_t resid_sketch_write (FILE *fp, RESID_SKETCH *sketch);
+  int32_t resid_sketch_read (FILE *fp, RESID_SKETCH *sketch);
+
+  void sketch_table_init (SKETCH_TABLE *table, int32_t size);
+  void sketch_table_free (SKETCH_TABLE *table);
+  RESID_SKETCH *sketch_table_get (SKETCH_TABLE *table, int32_t beam);
+  void sketch_table_merge (SKETCH_TABLE *total, SKETCH_TABLE *part);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,125 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <math.h>
+
+#include "resid_stats.h"
+
+
+void resid_stats_init (RESID_STATS *stats)
+{
+    stats->count = 0;
+    stats->neg_count = 0;
+    stats->mean = 0.0;
+    stats->m2 = 0.0;
+    stats->mean_depth = 0.0;
+    stats->min_val = 99999.0;
+    stats->max_val = -99999.0;
+    stats->min_depth = 99999.0;
+    stats->max_depth = -99999.0;
+}
+
+
+
+/*  Add one residual (Welford's method).  */
+
+void resid_stats_add (RESID_STATS *stats, double diff, double depth)
+{
+    double delta, abs_diff;
+
+
+    stats->count++;
+
+    delta = diff - stats->mean;
+    stats->mean += delta / (double) stats->count;
+    stats->m2 += delta * (diff - stats->mean);
+
+    stats->mean_depth += (depth - stats->mean_depth) / (double) stats->count;
+
+    if (diff < 0.0) stats->neg_count++;
+
+    abs_diff = fabs (diff);
+    if (abs_diff < stats->min_val) stats->min_val = abs_diff;
+    if (abs_diff > stats->max_val) stats->max_val = abs_diff;
+
+    if (depth < stats->min_depth) stats->min_depth = depth;
+    if (depth > stats->max_depth) stats->max_depth = depth;
+}
+
+
+
+/*  Combine "part" into "total" (Chan, Golub, and LeVeque pairwise update).  */
+
+void resid_stats_merge (RESID_STATS *total, RESID_STATS *part)
+{
+    double n_a, n_b, n, delta;
+
+
+    if (!part->count) return;
+
+    if (!total->count)
+        {
+            *total = *part;
+            return;
+        }
+
+    n_a = (double) total->count;
+    n_b = (double) part->count;
+    n = n_a + n_b;
+
+    delta = part->mean - total->mean;
+    total->mean += delta * (n_b / n);
+    total->m2 += part->m2 + delta * delta * (n_a * n_b / n);
+
+    total->mean_depth += (part->mean_depth - total->mean_depth) * (n_b / n);
+
+    total->count += part->count;
+    total->neg_count += part->neg_count;
+
+    if (part->min_val < total->min_val) total->min_val = part->min_val;
+    if (part->max_val > total->max_val) total->max_val = part->max_val;
+    if (part->min_depth < total->min_depth) total->min_depth = part->min_depth;
+    if (part->max_depth > total->max_depth) total->max_depth = part->max_depth;
+}
+
+
+
+/*  Sample variance of the residuals.  */
+
+double resid_stats_variance (RESID_STATS *stats)
+{
+    if (stats->count < 2) return (0.0);
+
+    return (stats->m2 / (double) (stats->count - 1));
+}
+
+
+
+/*  Root mean square of the residuals (not of the deviations from the mean).  */
+
+double resid_stats_rms (RESID_STATS *stats)
+{
+    if (!stats->count) return (0.0);
+
+    return (sqrt (stats->m2 / (double) stats->count + stats->mean * stats->mean));
+}
@@ -0,0 +1,66 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __RESID_STATS_H__
+#define __RESID_STATS_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdint.h>
+
+
+  /*  Repeatability statistics for one beam.  The residual (average filtered bin depth minus sounding
+      depth) mean and sum of squared deviations are kept with Welford's update so that the variance
+      doesn't suffer from the cancellation you get with sum2 - sum * mean.  Two of these can be combined
+      in constant time (Chan et al.) so partial results from row bands, threads, or separate runs can
+      be merged.  */
+
+  typedef struct
+  {
+    int64_t       count;               /*  number of residuals                      */
+    int64_t       neg_count;           /*  number of negative residuals             */
+    double        mean;                /*  mean residual                            */
+    double        m2;                  /*  sum of squared deviations from the mean  */
+    double        mean_depth;          /*  mean depth                               */
+    double        min_val;             /*  minimum absolute residual                */
+    double        max_val;             /*  maximum absolute residual                */
+    double        min_depth;           /*  minimum depth                            */
+    double        max_depth;           /*  maximum depth                            */
+  } RESID_STATS;
+
+
+  void resid_stats_init (RESID_STATS *stats);
+  void resid_stats_add (RESID_STATS *stats, double diff, double depth);
+  void resid_stats_merge (RESID_STATS *total, RESID_STATS *part);
+  double resid_stats_variance (RESID_STATS *stats);
+  double resid_stats_rms (RESID_STATS *stats);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
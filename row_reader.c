@@ -0,0 +1,404 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "row_reader.h"
+
+
+/*  Memory held by a row buffer.  */
+
+static int64_t row_buffer_bytes (ROW_BUFFER *buffer)
+{
+    return ((int64_t) buffer->width * (sizeof (BIN_VIEW) + sizeof (int32_t)) +
+            (int64_t) buffer->soundings.capacity * (3 * sizeof (int32_t) + sizeof (float) + sizeof (uint8_t)));
+}
+
+
+
+/*  Returns 0, or -1 (with nothing left to free) if the bin arrays can't be allocated.  */
+
+int32_t row_buffer_init (ROW_BUFFER *buffer, int32_t width)
+{
+    memset (buffer, 0, sizeof (ROW_BUFFER));
+
+    buffer->width = width;
+
+    buffer->bin = (BIN_VIEW *) malloc (width * sizeof (BIN_VIEW));
+    buffer->start = (int32_t *) malloc ((width + 1) * sizeof (int32_t));
+
+    if (buffer->bin == NULL || buffer->start == NULL)
+    {
+        free (buffer->bin);
+        free (buffer->start);
+        return (-1);
+    }
+
+    sounding_buffer_init (&buffer->soundings);
+
+    buffer->bytes = row_buffer_bytes (buffer);
+
+    return (0);
+}
+
+
+
+void row_buffer_free (ROW_BUFFER *buffer)
+{
+    free (buffer->bin);
+    free (buffer->start);
+    sounding_buffer_free (&buffer->soundings);
+}
+
+
+
+/*  Bin "j"'s soundings couldn't be read.  Leave it empty (nothing was appended for it) and count it.  */
+
+static void lost_bin (ROW_BUFFER *buffer, int32_t j)
+{
+    buffer->bin[j].num_soundings = 0;
+    buffer->read_errors++;
+}
+
+
+
+/*  READ_ROW for a PFM file ("source" points to the PFM handle).  Reads the bin records for "row" (from
+    buffer->column on) into buffer->records with one read_bin_row call, keeps the fields we need in
+    buffer->bin, and then reads all of the row's soundings, skipping empty bins and bins outside of the
+    buffer's polygon spans.  Returns 0 on success.  If the bin row can't be read the buffer holds an empty
+    row, and if a bin's soundings can't be read that bin is left empty.  Either way the bins lost are
+    counted in buffer->read_errors and -1 is returned.  If "profile" isn't NULL the read times and counts
+    are added to it.  */
+
+int32_t read_pfm_row (void *source, int32_t row, ROW_BUFFER *buffer, PROFILE *profile)
+{
+    NV_I32_COORD2           coord;
+    NV_I32_COORD2           *span = NULL, *end_span = NULL;
+    int32_t                 j, status = 0, pfm_handle = *((int32_t *) source);
+    int64_t                 start_ns = 0;
+
+
+    buffer->row = row;
+    buffer->soundings.count = 0;
+    buffer->read_errors = 0;
+
+    if (profile) start_ns = profile_clock ();
+
+    if (read_bin_row (pfm_handle, buffer->width, row, buffer->column, buffer->records))
+    {
+        memset (buffer->records, 0, buffer->width * sizeof (BIN_RECORD));
+        buffer->read_errors = buffer->width;
+    }
+
+    for (j = 0 ; j < buffer->width ; j++)
+    {
+        buffer->bin[j].num_soundings = buffer->records[j].num_soundings;
+        buffer->bin[j].validity = buffer->records[j].validity;
+        buffer->bin[j].avg_filtered_depth = buffer->records[j].avg_filtered_depth;
+    }
+
+    if (profile) profile->bin_read_ns += profile_clock () - start_ns;
+
+    if (buffer->region && buffer->region->row_span)
+    {
+        span = &buffer->region->span[buffer->region->row_span[row - buffer->region->y0]];
+        end_span = &buffer->region->span[buffer->region->row_span[row - buffer->region->y0 + 1]];
+    }
+
+    coord.y = row;
+
+    for (j = 0 ; j < buffer->width ; j++)
+    {
+        coord.x = buffer->column + j;
+
+        buffer->start[j] = buffer->soundings.count;
+
+
+        /*  Outside of the polygon.  */
+
+        if (span)
+        {
+            while (span < end_span && coord.x >= span->y) span++;
+
+            if (span == end_span || coord.x < span->x)
+            {
+                buffer->bin[j].num_soundings = 0;
+                continue;
+            }
+        }
+
+        if (profile && buffer->bin[j].num_soundings)
+        {
+            start_ns = profile_clock ();
+            if (append_bin_soundings (pfm_handle, coord, &buffer->records[j], &buffer->soundings) < 0)
+                lost_bin (buffer, j);
+            profile->depth_read_ns += profile_clock () - start_ns;
+            profile->populated_bins++;
+        }
+        else if (append_bin_soundings (pfm_handle, coord, &buffer->records[j], &buffer->soundings) < 0)
+        {
+            lost_bin (buffer, j);
+        }
+    }
+
+    buffer->start[buffer->width] = buffer->soundings.count;
+
+    if (buffer->read_errors) status = -1;
+
+    if (profile)
+    {
+        profile->bins += buffer->width;
+        profile->soundings += buffer->soundings.count;
+        profile->decoded_bytes += (int64_t) buffer->width * sizeof (BIN_RECORD) +
+            (int64_t) buffer->soundings.count * sizeof (DEPTH_RECORD);
+    }
+
+    return (status);
+}
+
+
+
+/*  Reader thread.  Claims bands and reads their rows into the ring until the bands run out.  */
+
+static void *row_reader_thread (void *arg)
+{
+    ROW_READER              *reader = (ROW_READER *) arg;
+    ROW_BUFFER              *slot;
+    int32_t                 band, row, start_row, end_row;
+    int64_t                 old_bytes;
+
+
+    while ((*reader->next_band) (reader->next_band_data, &band, &start_row, &end_row))
+    {
+        for (row = start_row ; row < end_row ; row++)
+        {
+            pthread_mutex_lock (&reader->mutex);
+
+            while (reader->filled == reader->queue_depth ||
+                   (reader->filled && reader->held_bytes >= reader->max_bytes))
+                pthread_cond_wait (&reader->cond, &reader->mutex);
+
+            slot = &reader->ring[reader->tail];
+
+            pthread_mutex_unlock (&reader->mutex);
+
+
+            old_bytes = slot->bytes;
+
+            (*reader->read_row) (reader->source, row, slot, reader->profile);
+            slot->bytes = row_buffer_bytes (slot);
+            slot->band = band;
+            slot->last = (row == end_row - 1);
+
+
+            pthread_mutex_lock (&reader->mutex);
+
+            reader->tail = (reader->tail + 1) % reader->queue_depth;
+            reader->filled++;
+            reader->held_bytes += slot->bytes - old_bytes;
+
+            pthread_cond_broadcast (&reader->cond);
+            pthread_mutex_unlock (&reader->mutex);
+        }
+    }
+
+
+    pthread_mutex_lock (&reader->mutex);
+    reader->done = NVTrue;
+    pthread_cond_broadcast (&reader->cond);
+    pthread_mutex_unlock (&reader->mutex);
+
+    return (NULL);
+}
+
+
+
+/*  Set up a reader.  Rows are "width" bins wide, starting at region->x0 (or column 0 if "region" is
+    NULL).  "next_band" is called (from the reader thread if there is one) to get each band of rows to
+    read.  "profile" (or NULL) is only touched by whichever thread does the reading, and so are the bin
+    records that all of the ring's buffers share.  Returns 0, or -1 (with nothing left to free) if the
+    ring can't be allocated or the reader thread can't be started.  */
+
+int32_t row_reader_init (ROW_READER *reader, READ_ROW read_row, void *source, int32_t width, REGION *region,
+                         int32_t queue_depth, int64_t max_bytes, NEXT_BAND next_band, void *next_band_data,
+                         PROFILE *profile)
+{
+    int32_t                 i, slots;
+
+
+    memset (reader, 0, sizeof (ROW_READER));
+
+    reader->read_row = read_row;
+    reader->source = source;
+    reader->width = width;
+    reader->next_band = next_band;
+    reader->next_band_data = next_band_data;
+    reader->profile = profile;
+    reader->queue_depth = queue_depth;
+    reader->max_bytes = max_bytes;
+
+    slots = queue_depth ? queue_depth : 1;
+
+    if ((reader->ring = (ROW_BUFFER *) malloc (slots * sizeof (ROW_BUFFER))) == NULL ||
+        (reader->records = (BIN_RECORD *) malloc (width * sizeof (BIN_RECORD))) == NULL)
+    {
+        free (reader->ring);
+        return (-1);
+    }
+
+    /*  "held_bytes" counts everything in the ring (empty slots keep their capacity) so the cap covers the
+        whole ring, not just the rows waiting to be used.  */
+
+    for (i = 0 ; i < slots ; i++)
+    {
+        if (row_buffer_init (&reader->ring[i], width))
+        {
+            while (--i >= 0) row_buffer_free (&reader->ring[i]);
+            free (reader->ring);
+            free (reader->records);
+            return (-1);
+        }
+
+        reader->ring[i].records = reader->records;
+        reader->ring[i].region = region;
+        reader->ring[i].column = region ? region->x0 : 0;
+        reader->held_bytes += reader->ring[i].bytes;
+    }
+
+
+    if (queue_depth)
+    {
+        pthread_mutex_init (&reader->mutex, NULL);
+        pthread_cond_init (&reader->cond, NULL);
+
+        if (pthread_create (&reader->thread, NULL, row_reader_thread, reader))
+        {
+            pthread_mutex_destroy (&reader->mutex);
+            pthread_cond_destroy (&reader->cond);
+
+            for (i = 0 ; i < slots ; i++) row_buffer_free (&reader->ring[i]);
+            free (reader->ring);
+            free (reader->records);
+
+            return (-1);
+        }
+    }
+
+    return (0);
+}
+
+
+
+/*  Returns the next row, or NULL when there are no more.  Every row returned has to be given back with
+    row_reader_release before asking for the next one.  */
+
+ROW_BUFFER *row_reader_next (ROW_READER *reader)
+{
+    ROW_BUFFER              *buffer;
+
+
+    if (!reader->queue_depth)
+    {
+        if (reader->row >= reader->end_row)
+        {
+            if (!(*reader->next_band) (reader->next_band_data, &reader->band, &reader->row, &reader->end_row))
+                return (NULL);
+        }
+
+        buffer = &reader->ring[0];
+
+        (*reader->read_row) (reader->source, reader->row, buffer, reader->profile);
+        buffer->band = reader->band;
+        buffer->last = (reader->row == reader->end_row - 1);
+
+        reader->row++;
+
+        return (buffer);
+    }
+
+
+    pthread_mutex_lock (&reader->mutex);
+
+    while (!reader->filled && !reader->done) pthread_cond_wait (&reader->cond, &reader->mutex);
+
+    buffer = reader->filled ? &reader->ring[reader->head] : NULL;
+
+    pthread_mutex_unlock (&reader->mutex);
+
+    return (buffer);
+}
+
+
+
+/*  Give a row back to the reader.  If the ring is holding more memory than allowed the row's sounding
+    storage is released rather than kept for reuse.  */
+
+void row_reader_release (ROW_READER *reader, ROW_BUFFER *buffer)
+{
+    int64_t                 old_bytes;
+
+
+    if (!reader->queue_depth) return;
+
+    pthread_mutex_lock (&reader->mutex);
+
+    if (reader->held_bytes > reader->max_bytes)
+    {
+        old_bytes = buffer->bytes;
+        sounding_buffer_free (&buffer->soundings);
+        buffer->bytes = row_buffer_bytes (buffer);
+        reader->held_bytes += buffer->bytes - old_bytes;
+    }
+
+    reader->head = (reader->head + 1) % reader->queue_depth;
+    reader->filled--;
+
+    pthread_cond_broadcast (&reader->cond);
+    pthread_mutex_unlock (&reader->mutex);
+}
+
+
+
+/*  Wait for the reader thread (the consumer must have read to the end) and free everything.  */
+
+void row_reader_free (ROW_READER *reader)
+{
+    int32_t                 i, slots;
+
+
+    if (reader->queue_depth)
+    {
+        pthread_join (reader->thread, NULL);
+        pthread_mutex_destroy (&reader->mutex);
+        pthread_cond_destroy (&reader->cond);
+    }
+
+    slots = reader->queue_depth ? reader->queue_depth : 1;
+
+    for (i = 0 ; i < slots ; i++) row_buffer_free (&reader->ring[i]);
+
+    free (reader->ring);
+    free (reader->records);
+}
@@ -0,0 +1,136 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __ROW_READER_H__
+#define __ROW_READER_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <pthread.h>
+
+#include "nvutility.h"
+
+#include "pfm.h"
+
+#include "sounding_buffer.h"
+#include "region.h"
+#include "profile.h"
+
+
+  /*  The parts of a BIN_RECORD that the statistics use, decoded from each row of bin records as it is
+      read.  The full records (well over 100 bytes each with the attributes) are only kept for the row
+      being read, so the rows waiting in the read ahead ring and the engine's bin loop only touch these
+      12 bytes per bin.  */
+
+  typedef struct
+  {
+    uint32_t      num_soundings;       /*  soundings in the bin (0 = nothing to read) */
+    uint32_t      validity;            /*  bin validity (PFM_DATA etc.)             */
+    float         avg_filtered_depth;  /*  reference depth for the residuals        */
+  } BIN_VIEW;
+
+
+  /*  Everything read for one row of bins.  The soundings for bin j are sounding indices start[j] through
+      start[j + 1] - 1.  */
+
+  typedef struct
+  {
+    int32_t       band;                /*  band this row belongs to                 */
+    int32_t       row;                 /*  bin row                                  */
+    uint8_t       last;                /*  NVTrue if this is the band's last row    */
+    int32_t       width;               /*  number of bins                           */
+    int32_t       column;              /*  grid column of bin[0]                    */
+    REGION        *region;             /*  polygon spans to read (NULL for all)     */
+    BIN_VIEW      *bin;                /*  bin summaries                            */
+    BIN_RECORD    *records;            /*  read_bin_row scratch (the reader's)      */
+    int32_t       *start;              /*  first sounding of each bin (width + 1)   */
+    SOUNDING_BUFFER soundings;         /*  soundings for the whole row              */
+    int32_t       read_errors;         /*  bins that couldn't be read (left empty)  */
+    int64_t       bytes;               /*  memory held by this buffer               */
+  } ROW_BUFFER;
+
+
+  /*  Reads one row from "source" into a ROW_BUFFER (read_pfm_row for a PFM file, see synthetic.c for the
+      benchmark's stand in).  Returns 0 on success, or -1 if some of it couldn't be read (with the bins
+      that couldn't be read left empty and counted in buffer->read_errors).  */
+
+  typedef int32_t (*READ_ROW) (void *source, int32_t row, ROW_BUFFER *buffer, PROFILE *profile);
+
+
+  /*  Hands out the next band of rows to read.  Returns NVFalse when there are no more.  */
+
+  typedef NV_BOOL (*NEXT_BAND) (void *data, int32_t *band, int32_t *start_row, int32_t *end_row);
+
+
+  /*  Reads rows for one consumer.  With a queue depth of 0 rows are read by the consumer's thread when it
+      asks for them.  Otherwise a reader thread keeps up to queue_depth rows (and no more than max_bytes
+      of them, though always at least one) read ahead in a ring so the consumer only waits on the disk
+      when it is actually faster than the disk.  */
+
+  typedef struct
+  {
+    READ_ROW      read_row;            /*  row read function                        */
+    void          *source;             /*  what read_row reads from                 */
+    int32_t       width;               /*  bins per row (region width)              */
+    NEXT_BAND     next_band;
+    void          *next_band_data;
+    PROFILE       *profile;            /*  read timing (NULL unless --profile)      */
+
+    int32_t       queue_depth;         /*  number of ring slots (0 = synchronous)   */
+    int64_t       max_bytes;           /*  cap on memory held in the ring           */
+    ROW_BUFFER    *ring;               /*  queue_depth (or 1) row buffers           */
+    BIN_RECORD    *records;            /*  bin records for the row being read       */
+    int32_t       head;                /*  next slot the consumer takes             */
+    int32_t       tail;                /*  next slot the reader fills               */
+    int32_t       filled;              /*  slots holding unconsumed rows            */
+    int64_t       held_bytes;          /*  memory held by all of the ring slots     */
+    NV_BOOL       done;                /*  reader has run out of bands              */
+
+    int32_t       band, row, end_row;  /*  synchronous mode read position           */
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    pthread_t     thread;
+  } ROW_READER;
+
+
+  int32_t row_buffer_init (ROW_BUFFER *buffer, int32_t width);
+  void row_buffer_free (ROW_BUFFER *buffer);
+  int32_t read_pfm_row (void *pfm_handle, int32_t row, ROW_BUFFER *buffer, PROFILE *profile);
+
+  int32_t row_reader_init (ROW_READER *reader, READ_ROW read_row, void *source, int32_t width, REGION *region,
+                           int32_t queue_depth, int64_t max_bytes, NEXT_BAND next_band, void *next_band_data,
+                           PROFILE *profile);
+  ROW_BUFFER *row_reader_next (ROW_READER *reader);
+  void row_reader_release (ROW_READER *reader, ROW_BUFFER *buffer);
+  void row_reader_free (ROW_READER *reader);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,301 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "nvutility.h"
+
+#include "sample.h"
+
+
+/*  Per band sums for one estimate.  x is the band's value of a total (or the denominator of a ratio) and
+    y the numerator.  */
+
+typedef struct
+{
+    double                  n;
+    double                  x, y;
+    double                  xx, yy, xy;
+} SUMS;
+
+
+
+static void sums_add (SUMS *sums, double x, double y)
+{
+    sums->n += 1.0;
+    sums->x += x;
+    sums->y += y;
+    sums->xx += x * x;
+    sums->yy += y * y;
+    sums->xy += x * y;
+}
+
+
+
+/*  Grid total of x estimated from the bands read (n of num_bands).  */
+
+static SAMPLE_VALUE sample_total (SUMS *sums, int32_t num_bands, double scale)
+{
+    SAMPLE_VALUE            value;
+    double                  variance;
+
+
+    value.value = scale * num_bands * sums->x / sums->n;
+    value.error = NAN;
+
+    if (sums->n >= 2.0)
+    {
+        variance = (sums->xx - sums->x * sums->x / sums->n) / (sums->n - 1.0);
+        if (variance < 0.0) variance = 0.0;
+
+        value.error = SAMPLE_Z * scale * num_bands * sqrt ((1.0 - sums->n / num_bands) * variance / sums->n);
+    }
+
+    return (value);
+}
+
+
+
+/*  Ratio of the y and x totals (the usual ratio estimator, with its linearized variance).  */
+
+static SAMPLE_VALUE sample_ratio (SUMS *sums, int32_t num_bands, double scale)
+{
+    SAMPLE_VALUE            value;
+    double                  ratio, variance, mean_x;
+
+
+    value.value = value.error = NAN;
+
+    if (sums->x == 0.0) return (value);
+
+    ratio = sums->y / sums->x;
+    value.value = scale * ratio;
+
+    if (sums->n >= 2.0)
+    {
+        variance = (sums->yy - 2.0 * ratio * sums->xy + ratio * ratio * sums->xx) / (sums->n - 1.0);
+        if (variance < 0.0) variance = 0.0;
+
+        mean_x = sums->x / sums->n;
+
+        value.error = SAMPLE_Z * scale * sqrt ((1.0 - sums->n / num_bands) * variance / sums->n) / mean_x;
+    }
+
+    return (value);
+}
+
+
+
+/*  Fills "order" with the num_bands band numbers in preview order.  The bit reversed sequence visits
+    every half of the grid, then every quarter, and so on, so any prefix is spread evenly over it.  The
+    whole sequence is rotated by a fixed pseudo random amount so that the first band isn't always the top
+    one, and the order is the same on every run.  */
+
+void sample_order (int32_t num_bands, int32_t *order)
+{
+    uint32_t                size, bits, offset, i, reversed, k;
+    int32_t                 n;
+
+
+    for (size = 1, bits = 0 ; size < (uint32_t) num_bands ; size <<= 1) bits++;
+
+    offset = ((uint32_t) SAMPLE_SEED * 1103515245u + 12345u) & (size - 1);
+
+    for (i = 0, n = 0 ; i < size ; i++)
+    {
+        for (k = 0, reversed = 0 ; k < bits ; k++) reversed |= ((i >> k) & 1) << (bits - 1 - k);
+
+        reversed = (reversed + offset) & (size - 1);
+
+        if (reversed < (uint32_t) num_bands) order[n++] = reversed;
+    }
+}
+
+
+
+/*  Estimates the whole grid's numbers from the partial results of the first bands_read bands in "order".  */
+
+void sample_estimate (SAMPLE_ESTIMATE *estimate, BEAM_STATS **band_stats, int32_t *order, int32_t bands_read,
+                      int32_t num_bands, double bin_size_xy)
+{
+    BEAM_STATS              *part;
+    BEAM_RECORD             *record;
+    BEAM_COUNTS             *flushed;
+    SUMS                    file, bins, *counts, *diffs, *squares;
+    double                  sum, square;
+    int64_t                 depths, bad;
+    int32_t                 i, k;
+
+
+    memset (estimate, 0, sizeof (SAMPLE_ESTIMATE));
+    estimate->bands_read = bands_read;
+    estimate->num_bands = num_bands;
+
+    for (k = 0 ; k < bands_read ; k++)
+    {
+        part = band_stats[order[k]];
+        if (part->beams.size > estimate->num_beams) estimate->num_beams = part->beams.size;
+    }
+
+    if ((estimate->beam = (SAMPLE_BEAM *) calloc (estimate->num_beams + 1, sizeof (SAMPLE_BEAM))) == NULL ||
+        (counts = (SUMS *) calloc (3 * (estimate->num_beams + 1), sizeof (SUMS))) == NULL)
+    {
+        perror ("Allocating sample estimate");
+        exit (-1);
+    }
+
+    diffs = counts + estimate->num_beams + 1;
+    squares = diffs + estimate->num_beams + 1;
+    memset (&file, 0, sizeof (SUMS));
+    memset (&bins, 0, sizeof (SUMS));
+
+
+    /*  A beam that doesn't appear in a band still counts as a band with zeros.  */
+
+    for (k = 0 ; k < bands_read ; k++)
+    {
+        part = band_stats[order[k]];
+
+        sums_add (&file, (double) (part->total_good + part->total_bad), (double) part->total_bad);
+        sums_add (&bins, (double) part->bin_count, 0.0);
+
+        for (i = 0 ; i < estimate->num_beams ; i++)
+        {
+            if (i < part->beams.size)
+            {
+                record = &part->beams.beam[i];
+                flushed = &part->beams.count[i];
+
+
+                /*  A band's counters may have been flushed into its 64 bit counts (BEAM_COUNTER_LIMIT).  */
+
+                depths = (int64_t) record->total_depths + flushed->total_depths;
+                bad = (int64_t) record->bad + flushed->bad;
+
+                sum = record->resid.mean * record->resid.count;
+                square = record->resid.m2 + record->resid.mean * sum;
+
+                sums_add (&counts[i], (double) depths, (double) bad);
+                sums_add (&diffs[i], (double) record->resid.count, sum);
+                sums_add (&squares[i], (double) record->resid.count, square);
+
+                estimate->beam[i].sampled += depths;
+            }
+            else
+            {
+                sums_add (&counts[i], 0.0, 0.0);
+                sums_add (&diffs[i], 0.0, 0.0);
+                sums_add (&squares[i], 0.0, 0.0);
+            }
+        }
+    }
+
+
+    estimate->soundings = sample_total (&file, num_bands, 1.0);
+    estimate->percent_bad = sample_ratio (&file, num_bands, 100.0);
+    estimate->square_kilometers = sample_total (&bins, num_bands, (bin_size_xy * bin_size_xy) / (1000.0 * 1000.0));
+
+    for (i = 0 ; i < estimate->num_beams ; i++)
+    {
+        estimate->beam[i].soundings = sample_total (&counts[i], num_bands, 1.0);
+        estimate->beam[i].percent_bad = sample_ratio (&counts[i], num_bands, 100.0);
+        estimate->beam[i].mean = sample_ratio (&diffs[i], num_bands, 1.0);
+
+
+        /*  The RMS is the square root of the mean square, so its error is about half the relative error of
+            the mean square.  */
+
+        estimate->beam[i].rms = sample_ratio (&squares[i], num_bands, 1.0);
+        estimate->beam[i].rms.value = sqrt (estimate->beam[i].rms.value);
+        if (estimate->beam[i].rms.value > 0.0) estimate->beam[i].rms.error /= 2.0 * estimate->beam[i].rms.value;
+    }
+
+    free (counts);
+}
+
+
+
+void sample_free (SAMPLE_ESTIMATE *estimate)
+{
+    free (estimate->beam);
+    estimate->beam = NULL;
+    estimate->num_beams = 0;
+}
+
+
+
+/*  "value +/- error" in a field of "width" characters ("-" if there's no data, "?" for the error before
+    there are two bands to estimate it from).  */
+
+static char *value_string (char *string, SAMPLE_VALUE *value, int32_t width, int32_t precision)
+{
+    char                    text[64];
+
+
+    if (isnan (value->value)) strcpy (text, "-");
+    else if (isnan (value->error)) sprintf (text, "%.*f +/- ?", precision, value->value);
+    else sprintf (text, "%.*f +/- %.*f", precision, value->value, precision, value->error);
+
+    sprintf (string, "%*s", width, text);
+
+    return (string);
+}
+
+
+
+/*  One preview table (comments start with # like the report, so each step can be plotted).  */
+
+void sample_report (FILE *fp, SAMPLE_ESTIMATE *estimate)
+{
+    SAMPLE_BEAM             *beam;
+    int32_t                 i;
+    char                    soundings[64], bad[64], mean[64], rms[64], area[64];
+
+
+    fprintf (fp, "#\n#Preview from %d of %d bands (%.1f%%), estimates with %.0f%% confidence intervals\n#\n",
+             estimate->bands_read, estimate->num_bands, (double) estimate->bands_read / estimate->num_bands * 100.0,
+             95.0);
+
+    fprintf (fp, "#Soundings:  %s\n", value_string (soundings, &estimate->soundings, 0, 0));
+    fprintf (fp, "#%%BAD:  %s\n", value_string (bad, &estimate->percent_bad, 0, 2));
+    fprintf (fp, "#Square kilometers covered:  %s\n#\n", value_string (area, &estimate->square_kilometers, 0, 4));
+
+    fprintf (fp, "# BEAM #            %%BAD                MEAN DIFF                 RMS DIFF"
+             "                  # SOUNDINGS   # SAMPLED\n#\n");
+
+    for (i = 0 ; i < estimate->num_beams ; i++)
+    {
+        beam = &estimate->beam[i];
+
+        if (!beam->sampled) continue;
+
+        fprintf (fp, "   %3d   %16s   %22s   %22s   %26s  %10lld\n", i + 1,
+                 value_string (bad, &beam->percent_bad, 16, 2), value_string (mean, &beam->mean, 22, 4), value_string (rms, &beam->rms, 22, 4),
+                 value_string (soundings, &beam->soundings, 26, 0), (long long) beam->sampled);
+    }
+
+    fflush (fp);
+}
@@ -0,0 +1,89 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+#ifndef __SAMPLE_H__
+#define __SAMPLE_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdio.h>
+
+#include "nvutility.h"
+
+#include "engine.h"
+
+
+  /*  The preview (--sample) reads the row bands in a fixed, evenly spread order so that the first n bands
+      are always a stratified sample of the grid.  After each step the per beam numbers are estimated from
+      the bands read so far, with 95% confidence intervals that treat them as a simple random sample of
+      bands (which overstates the error a little for an evenly spread sample).  The finite population
+      correction takes the intervals to zero once every band has been read.  */
+
+#define       SAMPLE_Z             1.96
+#define       SAMPLE_SEED          20261017
+#define       SAMPLE_MAX_STEPS     16
+
+
+  typedef struct
+  {
+    double        value;               /*  estimate (NaN if there is no data)       */
+    double        error;               /*  half width of the confidence interval    */
+  } SAMPLE_VALUE;
+
+
+  typedef struct
+  {
+    int64_t       sampled;             /*  soundings in the bands read so far       */
+    SAMPLE_VALUE  soundings;           /*  estimated soundings in the whole grid    */
+    SAMPLE_VALUE  percent_bad;         /*  edited soundings (%)                     */
+    SAMPLE_VALUE  mean;                /*  mean residual                            */
+    SAMPLE_VALUE  rms;                 /*  RMS residual                             */
+  } SAMPLE_BEAM;
+
+
+  typedef struct
+  {
+    int32_t       bands_read;          /*  bands in the sample                      */
+    int32_t       num_bands;           /*  bands in the grid (or region)            */
+    SAMPLE_VALUE  soundings;           /*  estimated total soundings                */
+    SAMPLE_VALUE  percent_bad;         /*  edited soundings (%)                     */
+    SAMPLE_VALUE  square_kilometers;   /*  area of bins with good data              */
+    int32_t       num_beams;
+    SAMPLE_BEAM   *beam;               /*  beam[i] is beam i + 1                    */
+  } SAMPLE_ESTIMATE;
+
+
+  void sample_order (int32_t num_bands, int32_t *order);
+  void sample_estimate (SAMPLE_ESTIMATE *estimate, BEAM_STATS **band_stats, int32_t *order, int32_t bands_read,
+                        int32_t num_bands, double bin_size_xy);
+  void sample_free (SAMPLE_ESTIMATE *estimate);
+  void sample_report (FILE *fp, SAMPLE_ESTIMATE *estimate);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
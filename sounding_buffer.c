@@ -0,0 +1,124 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sounding_buffer.h"
+
+
+void sounding_buffer_init (SOUNDING_BUFFER *buffer)
+{
+    buffer->count = 0;
+    buffer->capacity = 0;
+    buffer->validity = NULL;
+    buffer->z = NULL;
+    buffer->beam = NULL;
+    buffer->line = NULL;
+    buffer->sounding_class = NULL;
+}
+
+
+
+void sounding_buffer_free (SOUNDING_BUFFER *buffer)
+{
+    free (buffer->validity);
+    free (buffer->z);
+    free (buffer->beam);
+    free (buffer->line);
+    free (buffer->sounding_class);
+
+    sounding_buffer_init (buffer);
+}
+
+
+
+/*  Make sure there is room for "count" soundings.  Existing contents are preserved.  */
+
+void sounding_buffer_reserve (SOUNDING_BUFFER *buffer, int32_t count)
+{
+    int32_t capacity;
+
+
+    if (count <= buffer->capacity) return;
+
+    capacity = buffer->capacity ? buffer->capacity : 64;
+    while (capacity < count) capacity *= 2;
+
+    buffer->validity = (uint32_t *) realloc (buffer->validity, capacity * sizeof (uint32_t));
+    buffer->z = (float *) realloc (buffer->z, capacity * sizeof (float));
+    buffer->beam = (int32_t *) realloc (buffer->beam, capacity * sizeof (int32_t));
+    buffer->line = (int32_t *) realloc (buffer->line, capacity * sizeof (int32_t));
+    buffer->sounding_class = (uint8_t *) realloc (buffer->sounding_class, capacity);
+
+    if (buffer->validity == NULL || buffer->z == NULL || buffer->beam == NULL || buffer->line == NULL ||
+        buffer->sounding_class == NULL)
+    {
+        perror ("Allocating sounding buffer");
+        exit (-1);
+    }
+
+    buffer->capacity = capacity;
+}
+
+
+
+/*  Append the soundings for the bin described by "bin_record" (at "coord") to "buffer".  Returns the
+    number of soundings added, or -1 if the bin couldn't be read.
+
+    The caller has already read the bin record (normally a whole row at a time with read_bin_row) so
+    empty bins are skipped without touching the depth chain at all.  Populated bins still cost one
+    malloc and free each: the PFM library's only public depth read is read_depth_array_index, which
+    allocates the DEPTH_RECORD array.  The copy isn't there to avoid that.  It packs the four fields we
+    use into the row's arrays, so a whole row can be classified in one pass (classify.c) and the read
+    ahead queue holds 17 bytes per sounding instead of a full DEPTH_RECORD.  */
+
+int32_t append_bin_soundings (int32_t pfm_handle, NV_I32_COORD2 coord, BIN_RECORD *bin_record,
+                              SOUNDING_BUFFER *buffer)
+{
+    DEPTH_RECORD            *depth;
+    int32_t                 m, n, recnum;
+
+
+    if (!bin_record->num_soundings) return (0);
+
+    if (read_depth_array_index (pfm_handle, coord, &depth, &recnum)) return (-1);
+
+    sounding_buffer_reserve (buffer, buffer->count + recnum);
+
+    n = buffer->count;
+
+    for (m = 0 ; m < recnum ; m++, n++)
+    {
+        buffer->validity[n] = depth[m].validity;
+        buffer->z[n] = depth[m].xyz.z;
+        buffer->beam[n] = depth[m].beam_number;
+        buffer->line[n] = depth[m].line_number;
+    }
+
+    free (depth);
+
+    buffer->count = n;
+
+    return (recnum);
+}
@@ -0,0 +1,65 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __SOUNDING_BUFFER_H__
+#define __SOUNDING_BUFFER_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include "nvutility.h"
+
+#include "pfm.h"
+
+
+  /*  The fields of a row's (or bin's) soundings that pfm_beamstats actually uses, stored as separate
+      arrays so the classification code can run straight down each one.  The buffer only ever grows so,
+      once it has reached the size of the largest row, it doesn't allocate anything itself (the PFM
+      library still allocates each populated bin's depth records, see append_bin_soundings).  */
+
+  typedef struct
+  {
+    int32_t       count;               /*  number of soundings in the buffer        */
+    int32_t       capacity;            /*  number of soundings allocated            */
+    uint32_t      *validity;           /*  PFM validity bits                        */
+    float         *z;                  /*  depth                                    */
+    int32_t       *beam;               /*  beam number                              */
+    int32_t       *line;               /*  line number                              */
+    uint8_t       *sounding_class;     /*  SOUNDING_* class bits (see classify.h)   */
+  } SOUNDING_BUFFER;
+
+
+  void sounding_buffer_init (SOUNDING_BUFFER *buffer);
+  void sounding_buffer_free (SOUNDING_BUFFER *buffer);
+  void sounding_buffer_reserve (SOUNDING_BUFFER *buffer, int32_t count);
+  int32_t append_bin_soundings (int32_t pfm_handle, NV_I32_COORD2 coord, BIN_RECORD *bin_record,
+                                SOUNDING_BUFFER *buffer);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
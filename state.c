@@ -0,0 +1,330 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include "nvutility.h"
+
+#include "state.h"
+
+
+/*  The state file is this header, "num_beams" BEAM_RECORDs and their BEAM_COUNTS, and then (with
+    STATE_QUANTILES) each of those beams' sketches.  It is written in native byte order; the header check rejects a state file
+    written by a different build.  */
+
+typedef struct
+{
+    char                    magic[12];
+    int32_t                 version;
+    int32_t                 record_size;       /* sizeof (BEAM_RECORD)                         */
+    int32_t                 runs;              /* PFM results merged into this one              */
+    int32_t                 flags;             /* STATE_QUANTILES, STATE_TVU, STATE_SUBSET, ... */
+    int32_t                 num_beams;
+    int32_t                 region[4];         /* window processed (with STATE_SUBSET)          */
+    int64_t                 total_filter;
+    int64_t                 total_manual;
+    int64_t                 total_pfm;
+    int64_t                 total_bad;
+    int64_t                 total_good;
+    int64_t                 total_select;
+    int64_t                 bin_count;
+    int64_t                 bin2_count;
+    int64_t                 bad_beams;
+    int64_t                 read_errors;
+    int64_t                 coverage[COVERAGE_LEVELS];
+    double                  sketch_accuracy;   /* SKETCH_ACCURACY                              */
+    double                  tvu_a;
+    double                  tvu_b;
+    double                  square_kilometers;
+    double                  square_nmiles;
+    double                  coverage_kilos[COVERAGE_LEVELS];
+    double                  coverage_nmiles[COVERAGE_LEVELS];
+    char                    list_path[1024];   /* the PFM (just the first one if merged)       */
+} STATE_HEADER;
+
+
+#define       STATE_QUANTILES      1
+#define       STATE_TVU            2
+#define       STATE_SUBSET         4
+#define       STATE_COUNTS_ONLY    8       /* --counts-only, the residual moments are empty  */
+
+
+
+/*  Write "result"'s accumulators to a temporary file and rename it over "path".  Returns 0 or -1.  */
+
+int32_t beamstats_save_state (char *path, BEAMSTATS_RESULT *result)
+{
+    BEAM_STATS              *stats = &result->stats;
+    STATE_HEADER            header;
+    RESID_SKETCH            empty;
+    FILE                    *fp;
+    char                    tmp_path[1100];
+    int32_t                 i, status = 0;
+
+
+    memset (&header, 0, sizeof (STATE_HEADER));
+    strcpy (header.magic, STATE_MAGIC);
+    header.version = STATE_VERSION;
+    header.record_size = sizeof (BEAM_RECORD);
+    header.runs = result->runs;
+    header.num_beams = stats->beams.size;
+    header.total_filter = stats->total_filter;
+    header.total_manual = stats->total_manual;
+    header.total_pfm = stats->total_pfm;
+    header.total_bad = stats->total_bad;
+    header.total_good = stats->total_good;
+    header.total_select = stats->total_select;
+    header.bin_count = stats->bin_count;
+    header.bin2_count = stats->bin2_count;
+    header.bad_beams = stats->bad_beams;
+    header.read_errors = stats->read_errors;
+    header.sketch_accuracy = SKETCH_ACCURACY;
+    header.square_kilometers = result->square_kilometers;
+    header.square_nmiles = result->square_nmiles;
+    snprintf (header.list_path, sizeof (header.list_path), "%s", result->list_path);
+
+    for (i = 0 ; i < COVERAGE_LEVELS ; i++)
+    {
+        header.coverage[i] = stats->coverage[i];
+        header.coverage_kilos[i] = result->coverage_kilos[i];
+        header.coverage_nmiles[i] = result->coverage_nmiles[i];
+    }
+
+    if (stats->sketches.size) header.flags |= STATE_QUANTILES;
+    if (stats->counts_only) header.flags |= STATE_COUNTS_ONLY;
+    if (result->subset)
+    {
+        header.flags |= STATE_SUBSET;
+        header.region[0] = result->region.x0;
+        header.region[1] = result->region.y0;
+        header.region[2] = result->region.x1;
+        header.region[3] = result->region.y1;
+    }
+
+    if (stats->tvu)
+    {
+        header.flags |= STATE_TVU;
+        header.tvu_a = sqrt (stats->tvu_a2);
+        header.tvu_b = sqrt (stats->tvu_b2);
+    }
+
+
+    if (snprintf (tmp_path, sizeof (tmp_path), "%s.tmp", path) >= (int) sizeof (tmp_path))
+    {
+        errno = ENAMETOOLONG;
+        return (-1);
+    }
+
+    if ((fp = fopen (tmp_path, "wb")) == NULL) return (-1);
+
+    if (fwrite (&header, sizeof (STATE_HEADER), 1, fp) != 1 ||
+        fwrite (stats->beams.beam, sizeof (BEAM_RECORD), stats->beams.size, fp) != (size_t) stats->beams.size ||
+        fwrite (stats->beams.count, sizeof (BEAM_COUNTS), stats->beams.size, fp) != (size_t) stats->beams.size)
+        status = -1;
+
+    memset (&empty, 0, sizeof (RESID_SKETCH));
+
+    for (i = 0 ; i < stats->beams.size && !status && (header.flags & STATE_QUANTILES) ; i++)
+    {
+        if (resid_sketch_write (fp, i < stats->sketches.size ? &stats->sketches.sketch[i] : &empty)) status = -1;
+    }
+
+    if (fclose (fp)) status = -1;
+
+    if (status || rename (tmp_path, path))
+    {
+        remove (tmp_path);
+        return (-1);
+    }
+
+    return (0);
+}
+
+
+
+/*  Read one state file into "stats".  Returns 0 or -1.  */
+
+static int32_t read_state (char *path, STATE_HEADER *header, BEAM_STATS *stats)
+{
+    FILE                    *fp;
+    int32_t                 i, status = 0;
+
+
+    init_beam_stats (stats);
+
+    if ((fp = fopen (path, "rb")) == NULL) return (-1);
+
+    if (fread (header, sizeof (STATE_HEADER), 1, fp) != 1 || strcmp (header->magic, STATE_MAGIC) ||
+        header->version != STATE_VERSION || header->record_size != sizeof (BEAM_RECORD) ||
+        header->sketch_accuracy != SKETCH_ACCURACY || header->num_beams < 0 || header->num_beams > BEAM_TABLE_LIMIT)
+    {
+        fclose (fp);
+        return (-1);
+    }
+
+    header->list_path[sizeof (header->list_path) - 1] = 0;
+
+    stats->total_filter = header->total_filter;
+    stats->total_manual = header->total_manual;
+    stats->total_pfm = header->total_pfm;
+    stats->total_bad = header->total_bad;
+    stats->total_good = header->total_good;
+    stats->total_select = header->total_select;
+    stats->bin_count = header->bin_count;
+    stats->bin2_count = header->bin2_count;
+    stats->bad_beams = header->bad_beams;
+    stats->read_errors = header->read_errors;
+    memcpy (stats->coverage, header->coverage, COVERAGE_LEVELS * sizeof (int64_t));
+
+    if (header->num_beams) beam_table_grow (&stats->beams, header->num_beams - 1);
+
+    if (fread (stats->beams.beam, sizeof (BEAM_RECORD), header->num_beams, fp) != (size_t) header->num_beams ||
+        fread (stats->beams.count, sizeof (BEAM_COUNTS), header->num_beams, fp) != (size_t) header->num_beams)
+        status = -1;
+
+    if (!status && (header->flags & STATE_QUANTILES))
+    {
+        sketch_table_init (&stats->sketches, header->num_beams ? header->num_beams : 1);
+
+        for (i = 0 ; i < header->num_beams && !status ; i++)
+            status = resid_sketch_read (fp, &stats->sketches.sketch[i]);
+    }
+
+    fclose (fp);
+
+    return (status);
+}
+
+
+
+static void free_stats (BEAM_STATS *stats)
+{
+    beam_table_free (&stats->beams);
+    sketch_table_free (&stats->sketches);
+}
+
+
+
+/*  Combine the state files in "paths" into one result, in the order given.  Quantiles are kept only if
+    every file has them, TVU counts only if every file used the same TVU, and the repeatability statistics
+    only if no file was --counts-only.  Returns NULL with "failed" set to the index of the file if a file
+    can't be read, or to -1 if there isn't enough memory.  The caller frees the result with
+    beamstats_free_result.  */
+
+BEAMSTATS_RESULT *beamstats_merge_states (int32_t num_files, char **paths, int32_t *failed)
+{
+    BEAMSTATS_RESULT        *result;
+    BEAM_STATS              part;
+    STATE_HEADER            header;
+    NV_BOOL                 quantiles = NVTrue, tvu = NVTrue, counts_only = NVFalse;
+    double                  tvu_a = 0.0, tvu_b = 0.0;
+    int32_t                 i, k;
+
+
+    if ((result = (BEAMSTATS_RESULT *) calloc (1, sizeof (BEAMSTATS_RESULT))) == NULL)
+    {
+        *failed = -1;
+        return (NULL);
+    }
+
+    init_beam_stats (&result->stats);
+
+    for (i = 0 ; i < num_files ; i++)
+    {
+        if (read_state (paths[i], &header, &part))
+        {
+            free_stats (&part);
+            beamstats_free_result (result);
+            *failed = i;
+            return (NULL);
+        }
+
+        if (!i)
+        {
+            strcpy (result->list_path, header.list_path);
+            tvu_a = header.tvu_a;
+            tvu_b = header.tvu_b;
+
+
+            /*  A window only means something for a single PFM.  */
+
+            if (num_files == 1 && header.runs == 1 && (header.flags & STATE_SUBSET))
+            {
+                result->region.x0 = header.region[0];
+                result->region.y0 = header.region[1];
+                result->region.x1 = header.region[2];
+                result->region.y1 = header.region[3];
+                result->subset = NVTrue;
+            }
+        }
+
+        if (!(header.flags & STATE_QUANTILES)) quantiles = NVFalse;
+        if (header.flags & STATE_COUNTS_ONLY) counts_only = NVTrue;
+        if (!(header.flags & STATE_TVU) || header.tvu_a != tvu_a || header.tvu_b != tvu_b) tvu = NVFalse;
+
+        merge_beam_stats (&result->stats, &part);
+        free_stats (&part);
+
+        result->runs += header.runs;
+        result->square_kilometers += header.square_kilometers;
+        result->square_nmiles += header.square_nmiles;
+
+        for (k = 0 ; k < COVERAGE_LEVELS ; k++)
+        {
+            result->coverage_kilos[k] += header.coverage_kilos[k];
+            result->coverage_nmiles[k] += header.coverage_nmiles[k];
+        }
+    }
+
+
+    /*  Part of the residuals would be missing from the moments, so drop them all.  */
+
+    if (counts_only)
+    {
+        for (i = 0 ; i < result->stats.beams.size ; i++) resid_stats_init (&result->stats.beams.beam[i].resid);
+
+        result->stats.counts_only = NVTrue;
+        quantiles = tvu = NVFalse;
+    }
+
+    if (!quantiles) sketch_table_free (&result->stats.sketches);
+
+    if (tvu && num_files)
+    {
+        result->stats.tvu = NVTrue;
+        result->stats.tvu_a2 = tvu_a * tvu_a;
+        result->stats.tvu_b2 = tvu_b * tvu_b;
+    }
+
+    if (result->runs > 1) snprintf (result->list_path, sizeof (result->list_path), "%d PFM files", result->runs);
+
+    result->grand_total = result->stats.total_bad + result->stats.total_good;
+    result->s2_kilos = result->coverage_kilos[1];
+    result->s2_nmiles = result->coverage_nmiles[1];
+
+    return (result);
+}
@@ -0,0 +1,53 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __STATE_H__
+#define __STATE_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include "beamstats.h"
+
+
+#define       STATE_MAGIC          "PFMBSSTATE"
+#define       STATE_VERSION        3
+
+
+  /*  A state file holds a result's accumulators (the totals, the per beam records with their residual
+      moments, and the quantile sketches if there are any) rather than the finished numbers, so that
+      results for any number of PFM files can be combined later without reading the data again.  The
+      counts and sketches merge exactly; the residual moments are combined the same way the row bands
+      are.  Coverage areas are added, so the PFMs are assumed not to overlap.  */
+
+  int32_t beamstats_save_state (char *path, BEAMSTATS_RESULT *result);
+  BEAMSTATS_RESULT *beamstats_merge_states (int32_t num_files, char **paths, int32_t *failed);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
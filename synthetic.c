@@ -0,0 +1,228 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pfm.h"
+
+#include "synthetic.h"
+
+
+void synth_default_params (SYNTH_PARAMS *params)
+{
+    params->width = 1024;
+    params->height = 1024;
+    params->soundings_per_bin = 8;
+    params->beams = 256;
+    params->lines = 4;
+    params->manual_pct = 5.0;
+    params->filter_pct = 5.0;
+    params->deleted_pct = 1.0;
+    params->selected_pct = 2.0;
+    params->modified_pct = 10.0;
+    params->empty_pct = 10.0;
+    params->seed = 1;
+}
+
+
+
+/*  Small, fast, repeatable random numbers (xorshift32).  */
+
+static uint32_t synth_random (uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return (*state = x);
+}
+
+
+
+/*  Uniform on [0, 100).  */
+
+static float synth_percent (uint32_t *state)
+{
+    return ((float) (synth_random (state) % 100000) * 0.001);
+}
+
+
+
+/*  Generate SYNTH_ROWS rows of bins and soundings.  The depth surface is a gentle slope with per beam
+    bias and random noise so the repeatability statistics have something to chew on.  Returns 0, or -1
+    (with nothing left to free) if the rows can't be allocated.  */
+
+int32_t synth_init (SYNTH_SOURCE *synth, SYNTH_PARAMS *params)
+{
+    ROW_BUFFER              *row;
+    SOUNDING_BUFFER         *soundings;
+    int32_t                 i, j, m, n, good;
+    uint32_t                state, v;
+    float                   base, r, sum;
+
+
+    synth->params = *params;
+    synth->rows = params->height < SYNTH_ROWS ? params->height : SYNTH_ROWS;
+
+    state = params->seed ? params->seed : 1;
+
+
+    for (i = 0 ; i < synth->rows ; i++)
+    {
+        row = &synth->row[i];
+        soundings = &row->soundings;
+
+        if (row_buffer_init (row, params->width))
+        {
+            synth->rows = i;
+            synth_free (synth);
+            return (-1);
+        }
+
+        for (j = 0 ; j < params->width ; j++)
+        {
+            memset (&row->bin[j], 0, sizeof (BIN_VIEW));
+
+            row->start[j] = soundings->count;
+
+            if (synth_percent (&state) < params->empty_pct) continue;
+
+            n = params->soundings_per_bin / 2 + synth_random (&state) % (params->soundings_per_bin + 1);
+            if (!n) continue;
+
+            sounding_buffer_reserve (soundings, soundings->count + n);
+
+            base = 20.0 + (float) j * 0.01 + (float) i * 0.02;
+            sum = 0.0;
+            good = 0;
+
+            for (m = soundings->count ; m < soundings->count + n ; m++)
+            {
+                soundings->beam[m] = synth_random (&state) % params->beams;
+                soundings->line[m] = synth_random (&state) % params->lines;
+                soundings->z[m] = base + (float) soundings->beam[m] * 0.001 +
+                    ((float) (synth_random (&state) % 2001) - 1000.0) * 0.0005;
+
+                v = 0;
+
+                r = synth_percent (&state);
+                if (r < params->deleted_pct)
+                {
+                    v = PFM_DELETED;
+                }
+                else if (r < params->deleted_pct + params->manual_pct)
+                {
+                    v = PFM_MANUALLY_INVAL;
+                }
+                else if (r < params->deleted_pct + params->manual_pct + params->filter_pct)
+                {
+                    v = PFM_FILTER_INVAL;
+                }
+                else
+                {
+                    sum += soundings->z[m];
+                    good++;
+
+                    if (synth_percent (&state) < params->selected_pct) v |= PFM_SELECTED_SOUNDING;
+                }
+
+                if (synth_percent (&state) < params->modified_pct) v |= PFM_MODIFIED;
+
+                soundings->validity[m] = v;
+            }
+
+            soundings->count += n;
+
+            row->bin[j].num_soundings = n;
+
+            if (good)
+            {
+                row->bin[j].validity = PFM_DATA;
+                row->bin[j].avg_filtered_depth = sum / (float) good;
+            }
+        }
+
+        row->start[params->width] = soundings->count;
+    }
+
+    return (0);
+}
+
+
+
+void synth_free (SYNTH_SOURCE *synth)
+{
+    int32_t                 i;
+
+
+    for (i = 0 ; i < synth->rows ; i++) row_buffer_free (&synth->row[i]);
+
+    synth->rows = 0;
+}
+
+
+
+/*  READ_ROW for a SYNTH_SOURCE.  Copies generated row "row % SYNTH_ROWS" into "buffer" the way
+    read_pfm_row would fill it from the PFM library.  The source is read only so all workers can share
+    it.  */
+
+int32_t synth_read_row (void *source, int32_t row, ROW_BUFFER *buffer, PROFILE *profile)
+{
+    SYNTH_SOURCE            *synth = (SYNTH_SOURCE *) source;
+    ROW_BUFFER              *from;
+    int32_t                 count;
+    int64_t                 start_ns = 0;
+
+
+    from = &synth->row[row % synth->rows];
+    count = from->soundings.count;
+
+    if (profile) start_ns = profile_clock ();
+
+    buffer->row = row;
+
+    memcpy (buffer->bin, from->bin, buffer->width * sizeof (BIN_VIEW));
+    memcpy (buffer->start, from->start, (buffer->width + 1) * sizeof (int32_t));
+
+    sounding_buffer_reserve (&buffer->soundings, count);
+
+    memcpy (buffer->soundings.validity, from->soundings.validity, count * sizeof (uint32_t));
+    memcpy (buffer->soundings.z, from->soundings.z, count * sizeof (float));
+    memcpy (buffer->soundings.beam, from->soundings.beam, count * sizeof (int32_t));
+    memcpy (buffer->soundings.line, from->soundings.line, count * sizeof (int32_t));
+
+    buffer->soundings.count = count;
+
+    if (profile)
+    {
+        profile->depth_read_ns += profile_clock () - start_ns;
+        profile->bins += buffer->width;
+        profile->soundings += count;
+    }
+
+    return (0);
+}
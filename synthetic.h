@@ -0,0 +1,80 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __SYNTHETIC_H__
+#define __SYNTHETIC_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include "nvutility.h"
+
+#include "row_reader.h"
+
+
+  /*  Number of distinct rows generated.  Rows are reused (row % SYNTH_ROWS) so the generator's memory
+      doesn't depend on the grid height.  */
+
+#define       SYNTH_ROWS           16
+
+
+  typedef struct
+  {
+    int32_t       width;               /*  bins per row                             */
+    int32_t       height;              /*  rows                                     */
+    int32_t       soundings_per_bin;   /*  mean soundings per populated bin         */
+    int32_t       beams;               /*  beam numbers run 0 to beams - 1          */
+    int32_t       lines;               /*  line numbers run 0 to lines - 1          */
+    float         manual_pct;          /*  percent PFM_MANUALLY_INVAL               */
+    float         filter_pct;          /*  percent PFM_FILTER_INVAL                 */
+    float         deleted_pct;         /*  percent PFM_DELETED                      */
+    float         selected_pct;        /*  percent PFM_SELECTED_SOUNDING            */
+    float         modified_pct;        /*  percent PFM_MODIFIED                     */
+    float         empty_pct;           /*  percent of bins with no soundings        */
+    uint32_t      seed;
+  } SYNTH_PARAMS;
+
+
+  /*  In memory stand in for a PFM file.  Used as the "source" for synth_read_row.  */
+
+  typedef struct
+  {
+    SYNTH_PARAMS  params;
+    int32_t       rows;                /*  number of generated rows                 */
+    ROW_BUFFER    row[SYNTH_ROWS];     /*  generated rows                           */
+  } SYNTH_SOURCE;
+
+
+  void synth_default_params (SYNTH_PARAMS *params);
+  int32_t synth_init (SYNTH_SOURCE *synth, SYNTH_PARAMS *params);
+  void synth_free (SYNTH_SOURCE *synth);
+  int32_t synth_read_row (void *source, int32_t row, ROW_BUFFER *buffer, PROFILE *profile);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tile_stats.h"
+
+
+void tile_grid_init (TILE_GRID *grid, int32_t size, int32_t x0, int32_t y0, int32_t columns, int32_t first_row,
+                     int32_t rows)
+{
+    int32_t                 i;
+
+
+    grid->size = size;
+    grid->x0 = x0;
+    grid->y0 = y0;
+    grid->columns = columns;
+    grid->first_row = first_row;
+    grid->rows = rows;
+
+    if ((grid->tile = (TILE_STATS *) calloc (rows * columns, sizeof (TILE_STATS))) == NULL)
+    {
+        perror ("Allocating tiles");
+        exit (-1);
+    }
+
+    for (i = 0 ; i < rows * columns ; i++) resid_stats_init (&grid->tile[i].resid);
+}
+
+
+
+void tile_grid_free (TILE_GRID *grid)
+{
+    if (grid->tile) free (grid->tile);
+
+    memset (grid, 0, sizeof (TILE_GRID));
+}
+
+
+
+/*  Add the tiles in "part" to the same tiles in "total" (which has to cover all of part's rows).  */
+
+void tile_grid_merge (TILE_GRID *total, TILE_GRID *part)
+{
+    TILE_STATS              *t, *p;
+    int32_t                 i, offset;
+
+
+    if (!part->tile) return;
+
+    offset = (part->first_row - total->first_row) * total->columns;
+
+    for (i = 0 ; i < part->rows * part->columns ; i++)
+    {
+        p = &part->tile[i];
+
+        if (!p->good && !p->bad && !p->pfm && !p->select) continue;
+
+        t = &total->tile[offset + i];
+
+        t->bin_count += p->bin_count;
+        t->bin2_count += p->bin2_count;
+        t->good += p->good;
+        t->bad += p->bad;
+        t->manual += p->manual;
+        t->filter += p->filter;
+        t->pfm += p->pfm;
+        t->select += p->select;
+
+        resid_stats_merge (&t->resid, &p->resid);
+    }
+}
@@ -0,0 +1,77 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __TILE_STATS_H__
+#define __TILE_STATS_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdint.h>
+
+#include "resid_stats.h"
+
+
+  /*  Totals for one size x size tile of bins (all beams together).  */
+
+  typedef struct
+  {
+    RESID_STATS   resid;               /*  repeatability statistics                 */
+    int64_t       bin_count;           /*  bins with good data                      */
+    int64_t       bin2_count;          /*  bins with good data from 2 or more lines */
+    int64_t       good;                /*  good soundings                           */
+    int64_t       bad;                 /*  manual and filter edits                  */
+    int64_t       manual;
+    int64_t       filter;
+    int64_t       pfm;
+    int64_t       select;
+  } TILE_STATS;
+
+
+  /*  The tiles that cover tile rows first_row through first_row + rows - 1.  Tile (0, 0) starts at bin
+      (x0, y0) of the grid.  A band's partial only holds the tile rows that the band's bin rows touch.  */
+
+  typedef struct
+  {
+    int32_t       size;                /*  tile size in bins (0 = no tiles)         */
+    int32_t       x0, y0;              /*  bin at the corner of tile (0, 0)         */
+    int32_t       columns;             /*  tiles across                             */
+    int32_t       first_row;           /*  first tile row held                      */
+    int32_t       rows;                /*  number of tile rows held                 */
+    TILE_STATS    *tile;               /*  rows * columns tiles                     */
+  } TILE_GRID;
+
+
+  void tile_grid_init (TILE_GRID *grid, int32_t size, int32_t x0, int32_t y0, int32_t columns, int32_t first_row,
+                       int32_t rows);
+  void tile_grid_free (TILE_GRID *grid);
+  void tile_grid_merge (TILE_GRID *total, TILE_GRID *part);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
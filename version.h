@@ -38,7 +38,7 @@
 
 #ifndef VERSION
 
-#define     VERSION     "PFM Software - pfm_beamstats V2.38 - 07/29/14"
+#define     VERSION     "PFM Software - pfm_beamstats V2.64 - 10/17/26"
 
 #endif
 
@@ -197,4 +197,254 @@
 
     - Fixed errors discovered by cppcheck.
 
+
+    Version 2.39
+    PFM Software
+    10/17/26
+
+    - Added --threads option.  The bin rows are split into fixed size bands that are processed by worker
+      threads, each with its own PFM handle and its own statistics.  The band results are merged in band
+      order so the output does not depend on the number of threads used.
+
+
+    Version 2.40
+    PFM Software
+    10/17/26
+
+    - Replaced the per beam sum, sum2, and depthtot arrays with a RESID_STATS record (resid_stats.c)
+      that keeps the residual mean and variance using Welford's method and merges partial results using
+      Chan's pairwise update.  All of the accumulators (including min/max) are now double precision.
+
+
+    Version 2.41
+    PFM Software
+    10/17/26
+
+    - Replaced the MAX_BEAMS (1024) sized arrays with a BEAM_TABLE (beam_table.c) of per beam records that
+      grows to the highest beam number actually seen.  Beam numbers are range checked instead of silently
+      overrunning the arrays.
+    - The repeatability table now includes the highest numbered beam (it used to stop one short).
+
+
+    Version 2.42
+    PFM Software
+    10/17/26
+
+    - Bins are now read through read_bin_soundings (sounding_buffer.c).  It reads the bin record first and
+      skips empty bins without touching the depth chain.  For populated bins it copies beam, validity, depth,
+      and line into a per thread buffer that only ever grows, and releases the library's array right away.
+
+
+    Version 2.43
+    PFM Software
+    10/17/26
+
+    - Added --stream option.  A background thread reads the PFM depth (index) and bin files front to back in
+      16MB blocks while the bins are processed so the library's per bin chain reads hit the page cache
+      instead of seeking on disk.
+
+
+    Version 2.44
+    PFM Software
+    10/17/26
+
+    - Added classify_soundings (classify.c).  Each bin's validity words and depths are turned into class
+      bits and block totals in one branch free pass (AVX2 or SSE2 when the compiler allows it, scalar
+      otherwise).  The per sounding loop now just adds the class bits to the beam record.
+
+
+    Version 2.45
+    PFM Software
+    10/17/26
+
+    - The bin records for each row are now read with a single read_bin_row call ahead of the row's depth
+      reads instead of one read_bin_record_index call per bin.
+
+
+    Version 2.46
+    PFM Software
+    10/17/26
+
+    - Added --queue and --queue-mb options.  Each worker can now have a reader thread (row_reader.c) that
+      claims bands and reads their rows (bin records and soundings) into a bounded ring ahead of the
+      worker so reading and computing overlap.  Each row's soundings are classified as one block.
+
+
+    Version 2.47
+    PFM Software
+    10/17/26
+
+    - Added --profile option.  Prints the time spent opening, reading bin records, reading depths,
+      accumulating, waiting on the reader threads, and writing the report along with bins/s, soundings/s,
+      bytes read, and peak RSS.  The same numbers are written as JSON (profile.c).
+    - The percent processed display is now based on the number of rows actually finished.
+
+
+    Version 2.48
+    PFM Software
+    10/17/26
+
+    - Added --benchmark mode (benchmark.c).  The statistics engine (engine.c) now reads rows through a source
+      callback, so it can be timed on an in memory synthetic PFM (synthetic.c) with controlled beam, line,
+      and validity flag mixes.  Reports soundings/s and bins/s for a ladder of grid sizes.
+
+
+    Version 2.49
+    PFM Software
+    10/17/26
+
+    - Split the statistics out of main into an in process interface (beamstats.c, beamstats.h).  A caller
+      opens a PFM (or attaches a handle it already has open), accumulates, and finalizes to get a result with
+      the per beam counts and residual moments and the coverage areas.  PFM errors are returned instead of
+      exiting.  The text report moved to report.c and main is now just the command line front end.
+
+
+    Version 2.50
+    PFM Software
+    10/17/26
+
+    - Added --cache option (band_cache.c).  The per band partial results are saved in a sidecar file along
+      with a checksum of each band's bin records.  Later runs only read and accumulate the bands whose bin
+      records changed (i.e. bins that were edited) and merge the rest from the cache.  The report is the
+      same as a full pass.
+
+
+    Version 2.51
+    PFM Software
+    10/17/26
+
+    - Added --batch, --manifest, and --report-dir options (batch.c).  Any number of PFM files are processed
+      by one pool of threads pulling row bands from all of the files (largest files first).  A report is
+      written for each file and a summary of all of them goes to stdout.
+
+
+    Version 2.52
+    PFM Software
+    10/17/26
+
+    - Added --window, --bbox, and --polygon options (region.c).  Only the bins inside the bin window, lon/lat
+      rectangle, or polygon are read, so the run costs only the area asked for.
+    - Added --tiles option (tile_stats.c).  Totals and residual statistics for every N x N bin tile are
+      accumulated in the same pass and added to the end of the report.
+
+
+    Version 2.53
+    PFM Software
+    10/17/26
+
+    - Added --lines option (line_stats.c).  The repeatability table is also accumulated for each survey line
+      and beam in the same pass (in a hash table that only holds the line/beam pairs actually present) and
+      written after the report, or to a separate file, with the line file names.
+
+
+    Version 2.54
+    PFM Software
+    10/17/26
+
+    - Coverage is now counted from the number of distinct lines with good data in each bin (up to four) in
+      the main pass, and the report adds the area covered at 300% and 400% or better.
+
+
+    Version 2.55
+    PFM Software
+    10/17/26
+
+    - Added --percentiles, which keeps a mergeable quantile sketch of each beam's residuals
+      (resid_sketch.c) and reports the median and 95th and 99th percentile absolute residual,
+      and --tvu, which reports the percentage of each beam's residuals within the IHO S-44
+      total vertical uncertainty.
+
+
+    Version 2.56
+    PFM Software
+    10/17/26
+
+    - Added --format json|csv|binary (export.c) for machine readable reports with full precision
+      values.  Each report is built in memory and written with one fwrite.  The binary report is
+      an EXPORT_HEADER followed by EXPORT_BEAM records that can be read without parsing.  --batch
+      writes its per file reports in the same format.
+
+
+    Version 2.57
+    PFM Software
+    10/17/26
+
+    - Added --save-state, which writes the per beam accumulators (state.c) so that results can be
+      combined later, and --merge, which combines any number of state files into one report (and
+      optionally another state file) without reading the PFM data.  --batch --save-state writes a
+      state file next to each report.
+
+
+    Version 2.58
+    PFM Software
+    10/17/26
+
+    - Counts are now 64 bit everywhere they can grow with the size of the file (file totals, coverage,
+      per beam totals, residual counts, tiles, lines, and sketches).  The per beam records used in the
+      sounding loop keep 32 bit counters (so they stay 128 bytes) since they only ever hold one band;
+      they are added into 64 bit BEAM_COUNTS when bands are merged.  Band cache, state file, and
+      binary report versions were bumped.
+
+
+    Version 2.59
+    PFM Software
+    10/17/26
+
+    - Added --sample, a preview mode that reads the row bands in an evenly spread (bit reversed) order
+      and prints per beam estimates of %BAD, mean and RMS residual, and sounding counts with 95%
+      confidence intervals to stderr after 1, 5, and 25 percent of the bands (sample.c).  It then reads
+      the rest, and since every band is still merged in band order the report is identical to a normal
+      run.  run_engine can now be given a list of bands to process.
+
+
+    Version 2.60
+    PFM Software
+    10/17/26
+
+    - The row buffers now hold a 12 byte BIN_VIEW (num_soundings, validity, and avg_filtered_depth) per
+      bin instead of the whole BIN_RECORD.  The records from read_bin_row go into one scratch row per
+      reader and are decoded from there, so the read ahead ring and the engine's bin loop carry a small
+      fraction of the bin data.
+
+
+    Version 2.61
+    PFM Software
+    10/17/26
+
+    - Added --raster, which writes a GeoTIFF (raster.c, GDAL) of each bin's RMS residual, maximum absolute
+      residual, edited fraction, and number of distinct lines with good data.  The values are worked out
+      in the same pass into a per band BIN_GRID and each band is written out (through the engine's new
+      MERGE_BAND callback) as soon as it's merged, so memory doesn't grow with the size of the grid.
+
+
+    Version 2.62
+    PFM Software
+    10/17/26
+
+    - The sounding loop is now a template (engine_kernel.h) compiled into specialized kernels for the
+      common combinations of statistics (counts only, repeatability, percentiles, TVU) plus a generic one
+      that checks at run time.  run_engine picks the kernel once from the options.  Added --counts-only
+      for edit counts and coverage without the repeatability table (about twice as fast in the
+      benchmark).
+
+
+    Version 2.63
+    PFM Software
+    10/17/26
+
+    - Added --depth-bands to break the repeatability table down by depth (shallower than 40 m, 40 -
+      100 m, and deeper by default, or any list of boundaries).  Each beam's statistics for each band
+      are kept in a small beams x bands table (depth_stats.c) filled in the same pass, so the memory
+      doesn't depend on the number of soundings.  The bands are also in the JSON output.
+
+
+    Version 2.64
+    PFM Software
+    10/17/26
+
+    - Added --self-check, which runs a synthetic grid through the engine with one thread and with N
+      threads (with and without read ahead, with all of the optional statistics, and through a band cache
+      written out and read back) and checks that every result is bit for bit the same as the single
+      thread one.  Returns nonzero if any of them differ.
+
 */